@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Timing for the programs in bench, which make bench builds against the compiler's objects and
+// runs one after another. Each reports the best of a few runs, since the fastest run is the one
+// least disturbed by everything else on the machine.
+namespace nip {
+	namespace bench {
+		inline constexpr int runs = 7;
+
+		// Somewhere for results to go, so the work making them isn't optimized away
+		inline volatile size_t sink;
+
+		// Nanoseconds per operation of the best run of f, which does count operations
+		template <class F>
+		double time_per(size_t count, F&& f) {
+			double best = 1e300;
+			for (int i = 0; i < runs; i++) {
+				auto start = std::chrono::steady_clock::now();
+				f();
+				auto stop = std::chrono::steady_clock::now();
+				double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+				best      = std::min(best, ns);
+			}
+			return best / static_cast<double>(count);
+		}
+
+		inline void report(const char* name, double ns) {
+			std::printf("  %-28s %8.2f ns\n", name, ns);
+		}
+
+		// A small xorshift, so every run of a bench sees the same input
+		struct Random_t {
+			uint64_t state = 0x9E3779B97F4A7C15;
+
+			uint64_t operator()() {
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+				return state;
+			}
+		};
+	}
+}
@@ -0,0 +1,247 @@
+#include "../src/Parser/grammar.hpp"
+#include "../src/utilmacro.hpp"
+#include "bench.hpp"
+
+#include <vector>
+
+// Choosing a term by its first token through term_first, against the chain of accept() and is()
+// calls term() made before the table, one per production in the order they were written. Both
+// run over the same stream with a cursor that moves the way the parser's does, and call a
+// separate function for each production as term() does, so the chain can't be folded into a
+// table by the compiler. Only the choice is timed: the productions do nothing but take a token.
+namespace {
+	using namespace nip;
+	using nip::parse::Term_t;
+
+	NEVER_INLINE bool next_streamed(TokenType_t& type);
+
+	struct Cursor_t {
+		const TokenType_t* current;
+		const TokenType_t* end;
+		TokenType_t cur_type;
+		TokenType_t last_type = NUL;
+		bool streaming        = false;
+
+		Cursor_t(const std::vector<TokenType_t>& tokens)
+		    : current(tokens.data()), end(tokens.data() + tokens.size()), cur_type(*current) {}
+
+		ALWAYS_INLINE void next_sym() {
+			last_type = cur_type;
+			if (streaming) {
+				if (!next_streamed(cur_type)) {
+					cur_type = NUL;
+				}
+				return;
+			}
+			if (current != end) {
+				++current;
+			}
+			cur_type = current != end ? *current : NUL;
+		}
+		ALWAYS_INLINE bool is(TokenType_t tt) {
+			return cur_type == tt;
+		}
+		template <class... Args>
+		ALWAYS_INLINE bool is(TokenType_t tt, Args... a) {
+			return cur_type == tt || is(a...);
+		}
+		ALWAYS_INLINE bool accept(TokenType_t tt) {
+			if (cur_type == tt) {
+				next_sym();
+				return true;
+			}
+			return false;
+		}
+		template <class... Args>
+		ALWAYS_INLINE bool accept(TokenType_t tt, Args... a) {
+			if (cur_type == tt) {
+				next_sym();
+				return true;
+			}
+			return accept(a...);
+		}
+	};
+
+	NEVER_INLINE bool next_streamed(TokenType_t& type) {
+		type = NUL;
+		return false;
+	}
+
+	size_t made[parse::WITH_TERM + 1];
+
+	// Names and blocks read their own first token, and so does the error for a token that starts
+	// nothing, so that every term uses up one
+	template <Term_t T>
+	NEVER_INLINE void produce(Cursor_t& c) {
+		if (T == parse::NAME_TERM || T == parse::BLOCK_TERM || T == parse::NO_TERM) {
+			c.next_sym();
+		}
+		made[T]++;
+	}
+
+	// The tests of the old term()
+	NEVER_INLINE void chain(Cursor_t& c) {
+		if (c.accept(LIT_CHAR)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else if (c.accept(LIT_INT)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else if (c.accept(LIT_FLOAT)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else if (c.accept(LIT_DECIMAL)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else if (c.accept(LIT_STRING)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else if (c.is(IDENTIFIER, DOUBLE_COLON)) {
+			produce<parse::NAME_TERM>(c);
+		}
+		else if (c.accept(PLUS, LEFT_CARROT, RIGHT_CARROT)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else if (c.accept(LEFT_PAREN)) {
+			produce<parse::GROUP_TERM>(c);
+		}
+		else if (c.accept(LEFT_SQUARE)) {
+			produce<parse::VECTOR_TERM>(c);
+		}
+		else if (c.is(LEFT_BRACKET, INDENT)) {
+			produce<parse::BLOCK_TERM>(c);
+		}
+		else if (c.accept(ARROW)) {
+			produce<parse::LAMBDA_TERM>(c);
+		}
+		else if (c.accept(KEY_IF)) {
+			produce<parse::IF_TERM>(c);
+		}
+		else if (c.accept(KEY_MATCH)) {
+			produce<parse::MATCH_TERM>(c);
+		}
+		else if (c.accept(KEY_DO)) {
+			produce<parse::DO_TERM>(c);
+		}
+		else if (c.accept(KEY_WITH)) {
+			produce<parse::WITH_TERM>(c);
+		}
+		else if (c.accept(KEY_RET, KEY_JUMP, KEY_CALL)) {
+			produce<parse::LEAF_TERM>(c);
+		}
+		else {
+			produce<parse::NO_TERM>(c);
+		}
+	}
+
+	// The dispatch of term() now
+	NEVER_INLINE void table(Cursor_t& c) {
+		Term_t which = parse::term_first[c.cur_type];
+		if (which != parse::NAME_TERM && which != parse::BLOCK_TERM && which != parse::NO_TERM) {
+			c.next_sym();
+		}
+		switch (which) {
+			case parse::NO_TERM:
+				produce<parse::NO_TERM>(c);
+				break;
+			case parse::LEAF_TERM:
+				produce<parse::LEAF_TERM>(c);
+				break;
+			case parse::NAME_TERM:
+				produce<parse::NAME_TERM>(c);
+				break;
+			case parse::GROUP_TERM:
+				produce<parse::GROUP_TERM>(c);
+				break;
+			case parse::VECTOR_TERM:
+				produce<parse::VECTOR_TERM>(c);
+				break;
+			case parse::BLOCK_TERM:
+				produce<parse::BLOCK_TERM>(c);
+				break;
+			case parse::LAMBDA_TERM:
+				produce<parse::LAMBDA_TERM>(c);
+				break;
+			case parse::IF_TERM:
+				produce<parse::IF_TERM>(c);
+				break;
+			case parse::MATCH_TERM:
+				produce<parse::MATCH_TERM>(c);
+				break;
+			case parse::DO_TERM:
+				produce<parse::DO_TERM>(c);
+				break;
+			case parse::WITH_TERM:
+				produce<parse::WITH_TERM>(c);
+				break;
+		}
+	}
+
+	struct Weight_t {
+		TokenType_t type;
+		unsigned weight;
+	};
+
+	// First tokens of terms in roughly the proportions of the test programs: mostly names, then
+	// numbers, with the rest of the productions rare
+	constexpr Weight_t term_mix[] = {
+	    {IDENTIFIER, 50}, {LIT_INT, 14},    {LIT_FLOAT, 4},  {LIT_STRING, 4},  {LIT_CHAR, 1},
+	    {DOUBLE_COLON, 2}, {LEFT_PAREN, 6}, {LEFT_SQUARE, 3}, {LEFT_BRACKET, 2}, {INDENT, 2},
+	    {ARROW, 2},       {PLUS, 3},        {KEY_IF, 2},     {KEY_MATCH, 1},    {KEY_DO, 1},
+	    {KEY_WITH, 1},    {KEY_RET, 1},     {KEY_CALL, 1}};
+
+	std::vector<TokenType_t> make_tokens(size_t count) {
+		unsigned total = 0;
+		for (const Weight_t& w : term_mix) {
+			total += w.weight;
+		}
+		nip::bench::Random_t random;
+		std::vector<TokenType_t> tokens;
+		while (tokens.size() < count) {
+			unsigned pick = static_cast<unsigned>(random() % total);
+			for (const Weight_t& w : term_mix) {
+				if (pick < w.weight) {
+					tokens.push_back(w.type);
+					break;
+				}
+				pick -= w.weight;
+			}
+		}
+		return tokens;
+	}
+
+	// What each production was chosen for every token in the stream, in order
+	template <class F>
+	std::vector<size_t> choices(const std::vector<TokenType_t>& tokens, F&& dispatch) {
+		for (size_t& m : made) {
+			m = 0;
+		}
+		Cursor_t c(tokens);
+		while (c.current != c.end) {
+			dispatch(c);
+		}
+		return std::vector<size_t>(std::begin(made), std::end(made));
+	}
+
+	template <class F>
+	double time_dispatch(const std::vector<TokenType_t>& tokens, F&& dispatch) {
+		return nip::bench::time_per(tokens.size(), [&] {
+			Cursor_t c(tokens);
+			while (c.current != c.end) {
+				dispatch(c);
+			}
+		});
+	}
+}
+
+int main() {
+	std::vector<TokenType_t> tokens = make_tokens(1 << 20);
+	if (choices(tokens, chain) != choices(tokens, table)) {
+		std::printf("dispatch: term_first chose differently from the chain\n");
+		return 1;
+	}
+
+	std::printf("dispatch: per term chosen, of %zu mostly names and numbers\n", tokens.size());
+	nip::bench::report("chain of accept() and is()", time_dispatch(tokens, chain));
+	nip::bench::report("term_first", time_dispatch(tokens, table));
+}
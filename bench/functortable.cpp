@@ -0,0 +1,129 @@
+#include "../src/Parser/functortable.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Functor_Table against the vector the metadata pass searched before it, where every lookup was
+// a std::find_if down all the functors, comparing qualified names. That search took each entry by
+// value, copying its name, about pairs and documentation, so it is timed both as it was and taking
+// entries by reference, to tell the copies apart from the scan.
+namespace {
+	using Path_t = std::vector<nip::Symbol_t>;
+
+	struct Old_Functor_t {
+		std::vector<nip::Symbol_t> name;
+		size_t trait_argument_count = 0;
+		std::pair<size_t, size_t> argument_count = std::make_pair(size_t{0}, size_t{0});
+		intmax_t presidence = 0;
+		bool declared       = false;
+		bool abouted        = false;
+		std::unordered_map<nip::Symbol_t, std::vector<std::string>> about_pairs;
+		std::string documentation;
+	};
+
+	bool same_name(const Old_Functor_t& a, const Path_t& name) {
+		if (a.name.size() == name.size()) {
+			for (size_t i = 0; i < a.name.size(); i++) {
+				if (a.name[i] != name[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+		return false;
+	}
+
+	Old_Functor_t* find_by_value(std::vector<Old_Functor_t>& functors, const Path_t& name) {
+		auto found = std::find_if(functors.begin(), functors.end(),
+		                          [&name](auto a) { return same_name(a, name); });
+		return found == functors.end() ? nullptr : &*found;
+	}
+
+	Old_Functor_t* find_by_reference(std::vector<Old_Functor_t>& functors, const Path_t& name) {
+		auto found = std::find_if(functors.begin(), functors.end(),
+		                          [&name](const auto& a) { return same_name(a, name); });
+		return found == functors.end() ? nullptr : &*found;
+	}
+
+	// Names one to three deep, the deeper ones sharing their vocabularies like a real program's
+	std::vector<Path_t> make_paths(size_t count) {
+		nip::bench::Random_t random;
+		std::vector<Path_t> paths;
+		for (nip::Symbol_t i = 0; paths.size() < count; i++) {
+			Path_t path;
+			for (size_t depth = random() % 3; depth > 0; depth--) {
+				path.push_back(static_cast<nip::Symbol_t>(random() % 16));
+			}
+			path.push_back(1000 + i);
+			paths.push_back(std::move(path));
+		}
+		return paths;
+	}
+
+	// Every name looked up once, in an order unlike the one they were added in
+	std::vector<const Path_t*> lookup_order(const std::vector<Path_t>& paths) {
+		nip::bench::Random_t random;
+		std::vector<const Path_t*> order;
+		for (const Path_t& p : paths) {
+			order.push_back(&p);
+		}
+		for (size_t i = order.size() - 1; i > 0; i--) {
+			std::swap(order[i], order[random() % (i + 1)]);
+		}
+		return order;
+	}
+
+	template <class F>
+	double time_lookups(const std::vector<const Path_t*>& order, F&& find) {
+		return nip::bench::time_per(order.size(), [&] {
+			size_t found = 0;
+			for (const Path_t* p : order) {
+				found += find(*p) != nullptr;
+			}
+			nip::bench::sink = found;
+		});
+	}
+}
+
+int main() {
+	for (size_t count : {64, 512, 2048}) {
+		std::vector<Path_t> paths        = make_paths(count);
+		std::vector<const Path_t*> order = lookup_order(paths);
+
+		std::vector<Old_Functor_t> functors;
+		nip::parse::Functor_Table table;
+		for (const Path_t& p : paths) {
+			functors.emplace_back();
+			functors.back().name = p;
+			functors.back().about_pairs[p.back()].push_back("value");
+			functors.back().documentation = "Some documentation for the functor";
+			bool added;
+			table.get(p, added);
+		}
+		for (const Path_t* p : order) {
+			Functor_Pre_Info_t* f = table.find(*p);
+			if (!f || !std::equal(table.name(*f).begin(), table.name(*f).end(), p->begin(),
+			                      p->end())) {
+				std::printf("functortable: find gave the wrong entry\n");
+				return 1;
+			}
+		}
+
+		auto by_value     = [&](const Path_t& p) { return find_by_value(functors, p); };
+		auto by_reference = [&](const Path_t& p) { return find_by_reference(functors, p); };
+		auto find         = [&](const Path_t& p) { return table.find(p); };
+		auto get          = [&](const Path_t& p) {
+			bool added;
+			return &table.get(p, added);
+		};
+
+		std::printf("functortable: per lookup among %zu functors\n", count);
+		nip::bench::report("find_if by value", time_lookups(order, by_value));
+		nip::bench::report("find_if by reference", time_lookups(order, by_reference));
+		nip::bench::report("Functor_Table::find", time_lookups(order, find));
+		nip::bench::report("Functor_Table::get", time_lookups(order, get));
+	}
+}
@@ -0,0 +1,89 @@
+#include "../src/Lexer/keywords.hpp"
+#include "bench.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// classify_keyword against what the tokenizer did before it: copy the word into a std::string and
+// look it up in a map. A chain of comparisons down the keyword list is timed too, as the simplest
+// thing that doesn't allocate.
+namespace {
+	using nip::TokenType_t;
+	using nip::lex::keyword_count;
+	using nip::lex::keywords;
+
+	std::unordered_map<std::string, TokenType_t> keyword_map;
+
+	TokenType_t map_lookup(std::string_view word) {
+		std::string str(word);
+		auto itt = keyword_map.find(str);
+		return itt != keyword_map.end() ? itt->second : nip::IDENTIFIER;
+	}
+
+	TokenType_t comparison_chain(std::string_view word) {
+		for (auto& k : keywords) {
+			if (k.word == word) {
+				return k.type;
+			}
+		}
+		return nip::IDENTIFIER;
+	}
+
+	TokenType_t perfect_hash(std::string_view word) {
+		return nip::lex::classify_keyword(word);
+	}
+
+	// Mostly identifiers, with a keyword about every fourth word, like real source
+	std::vector<std::string> make_words(size_t count) {
+		const char letters[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+		nip::bench::Random_t random;
+		std::vector<std::string> words;
+		for (size_t i = 0; i < count; i++) {
+			if (random() % 4 == 0) {
+				words.emplace_back(keywords[random() % keyword_count].word);
+				continue;
+			}
+			std::string word(1, letters[random() % 26]);
+			for (size_t length = 1 + random() % 10; word.size() < length;) {
+				word += letters[random() % (sizeof(letters) - 1)];
+			}
+			words.push_back(std::move(word));
+		}
+		return words;
+	}
+
+	template <class F>
+	double time_lookup(const std::vector<std::string>& words, F&& lookup) {
+		constexpr size_t passes = 100;
+		return nip::bench::time_per(words.size() * passes, [&] {
+			size_t sum = 0;
+			for (size_t i = 0; i < passes; i++) {
+				for (const std::string& w : words) {
+					sum += lookup(std::string_view(w));
+				}
+			}
+			nip::bench::sink = sum;
+		});
+	}
+}
+
+int main() {
+	for (auto& k : keywords) {
+		keyword_map.emplace(k.word, k.type);
+	}
+	std::vector<std::string> words = make_words(4096);
+	for (const std::string& w : words) {
+		TokenType_t expected = map_lookup(w);
+		if (nip::lex::classify_keyword(w) != expected || comparison_chain(w) != expected) {
+			std::printf("keywords: classify_keyword disagrees with the map on \"%s\"\n", w.c_str());
+			return 1;
+		}
+	}
+
+	std::printf("keywords: per word of %zu, a quarter of them keywords\n", words.size());
+	nip::bench::report("string copy and map lookup", time_lookup(words, map_lookup));
+	nip::bench::report("comparison chain", time_lookup(words, comparison_chain));
+	nip::bench::report("classify_keyword", time_lookup(words, perfect_hash));
+}
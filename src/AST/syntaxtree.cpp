@@ -0,0 +1,101 @@
+#include "syntaxtree.hpp"
+#include "../util.hpp"
+
+#include <ostream>
+
+void nip::ast::Syntax_Tree::reserve(size_t token_count) {
+	// About half the tokens are leaves, and most of the rest are punctuation that doesn't make a
+	// node, so this is plenty without being much more than needed. The pending stack holds every
+	// top level element until the program is made, and is only grown if they are very short.
+	nodes.reserve(token_count / 2);
+	children.reserve(token_count);
+	pending.reserve(token_count / 8);
+}
+
+void nip::ast::Syntax_Tree::append(const Syntax_Tree& part) {
+	// Records are renumbered past the ones already here, and their runs of children start where
+	// this tree's children end. Token leaves are the same in any tree of the stream.
+	Node_t node_base     = static_cast<Node_t>(nodes.size());
+	uint32_t run_base    = static_cast<uint32_t>(children.size());
+	Node_Data_t* to_node = nodes.extend(part.nodes.size());
+	for (size_t i = 0; i < part.nodes.size(); i++) {
+		Node_Data_t n = part.nodes[i];
+		n.end += run_base;
+		to_node[i] = n;
+	}
+	auto renumber = [node_base](Arena_t<Node_t>& to, const Arena_t<Node_t>& from) {
+		Node_t* out = to.extend(from.size());
+		for (size_t i = 0; i < from.size(); i++) {
+			Node_t n = from[i];
+			out[i]   = n & token_node ? n : n + node_base;
+		}
+	};
+	renumber(children, part.children);
+	renumber(pending, part.pending);
+}
+
+const char* nip::ast::kind_name(Node_Kind_t k) {
+	static const char* names[NODE_KIND_COUNT] = {
+	    "PROGRAM",         "STATEMENT",      "TRAIT",           "INTRINSIC",
+	    "DEFINITION",      "INSTANCE",       "PERMISSION",      "ABOUT",
+	    "TYPE",            "TYPE_SYNONYM",   "VOCABULARY",      "VOCABULARY_SYNONYM",
+	    "IMPORT",          "IMPORT_TYPE",    "IMPORT_VOCABULARY", "DOCUMENTATION",
+	    "OPERATOR",        "METADATA_FIELD", "SIGNATURE",       "STACK_ARROW",
+	    "PERMISSION_NAME", "TYPE_APPLICATION", "TYPE_PARAMETERS", "PARAMETER",
+	    "TYPE_CASE",       "INT_LITERAL",    "FLOAT_LITERAL",   "DECIMAL_LITERAL",
+	    "CHAR_LITERAL",    "STRING_LITERAL", "NAME",            "ROOT",
+	    "OPERATOR_WORD",   "CONTROL_WORD",   "INFIX",           "GROUP",
+	    "VECTOR",          "BLOCK",          "LAMBDA",          "IF",
+	    "ELIF",            "ELSE",           "MATCH",           "CASE",
+	    "DO",              "WITH"};
+	return names[k];
+}
+
+void nip::ast::Syntax_Tree::print(std::ostream& os, const Token_Cache_t& tc, Node_t n,
+                                  size_t depth) const {
+	os << std::string(depth * 2, ' ') << kind_name(kind(n));
+	// Only kinds with a value read the payload, as a PROGRAM of no tokens points past the stream
+	switch (kind(n)) {
+		case NAME:
+		case INFIX:
+		case PARAMETER:
+		case METADATA_FIELD:
+			os << ' ' << tc.identifier[payload(n)];
+			break;
+		case INT_LITERAL:
+			os << ' ' << tc.integer[payload(n)];
+			break;
+		case FLOAT_LITERAL:
+			os << ' ' << tc.floating_pt[payload(n)];
+			break;
+		case DECIMAL_LITERAL:
+			os << ' ' << tc.decimal[payload(n)].to_string();
+			break;
+		case CHAR_LITERAL:
+			os << " '" << nip::util::special_sanitize(static_cast<char>(payload(n))) << '\'';
+			break;
+		case STRING_LITERAL:
+		case DOCUMENTATION:
+			os << " \"" << nip::util::special_sanitize(tc.string[payload(n)]) << '"';
+			break;
+		case OPERATOR:
+			os << (tokens->type(token(n)) == KEY_LEFT ? " left" : " right");
+			break;
+		case OPERATOR_WORD: {
+			TokenType_t t = tokens->type(token(n));
+			os << (t == PLUS ? " +" : t == LEFT_CARROT ? " <" : " >");
+			break;
+		}
+		case CONTROL_WORD: {
+			TokenType_t t = tokens->type(token(n));
+			os << (t == KEY_RET ? " return" : t == KEY_JUMP ? " jump" : " call");
+			break;
+		}
+		default:
+			break;
+	}
+	os << '\n';
+	for (Node_t child : (*this)[n]) {
+		print(os, tc, child, depth + 1);
+	}
+}
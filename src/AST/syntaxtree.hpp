@@ -0,0 +1,326 @@
+#pragma once
+
+#include "../token.hpp"
+#include "../tokenstream.hpp"
+#include "../utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iosfwd>
+#include <new>
+#include <type_traits>
+
+namespace nip {
+	namespace ast {
+		// Index of a node in its Syntax_Tree
+		using Node_t = uint32_t;
+
+		// Every node has a token, which is what its value (a pool index, Symbol_t or Literal_t)
+		// and its place in the source are read from
+		enum Node_Kind_t : uint8_t {
+			PROGRAM, // Every top level element
+
+			// Elements, all at their keyword. The name, where there is one, is the first child.
+			STATEMENT, // A line of terms, at its first
+			TRAIT,
+			INTRINSIC,
+			DEFINITION,
+			INSTANCE,
+			PERMISSION,
+			ABOUT,
+			TYPE,
+			TYPE_SYNONYM,
+			VOCABULARY, // Followed by its block, unless it was declared with a ;
+			VOCABULARY_SYNONYM,
+			IMPORT,
+			IMPORT_TYPE,       // Wraps the NAME of an import type
+			IMPORT_VOCABULARY, // Wraps the NAME of an import vocab
+
+			// About sections
+			DOCUMENTATION,  // At the text
+			OPERATOR,       // At left or right, with the precedence as its child
+			METADATA_FIELD, // At the key, with the values as its children
+
+			// Types
+			SIGNATURE,        // Inputs, then a STACK_ARROW, then outputs and PERMISSION_NAMEs
+			STACK_ARROW,      // The -> of a signature
+			PERMISSION_NAME,  // Wraps the NAME after a +
+			TYPE_APPLICATION, // A NAME followed by its arguments
+			TYPE_PARAMETERS,  // The <...> of a declaration, a PARAMETER each
+			PARAMETER,        // A name being bound
+			TYPE_CASE,        // A NAME followed by the types of its fields
+
+			// Terms
+			INT_LITERAL,
+			FLOAT_LITERAL,
+			DECIMAL_LITERAL,
+			CHAR_LITERAL,
+			STRING_LITERAL,
+			NAME,          // At the last name, with any vocabularies qualifying it as children
+			ROOT,          // The leading :: of a name qualified from the top vocabulary
+			OPERATOR_WORD, // A one byte word like +
+			CONTROL_WORD,  // return, jump or call
+			INFIX,         // At the operator, with its left operand then its right
+			GROUP,         // ( ... ), or an item of a vector with more than one term
+			VECTOR,
+			BLOCK,
+			LAMBDA, // A PARAMETER for every name bound
+			IF,     // Condition GROUP if given, the BLOCK, then ELIF and ELSE nodes
+			ELIF,
+			ELSE,
+			MATCH, // Scrutinee GROUP if given, then CASE and ELSE nodes
+			CASE,  // NAME, the LAMBDA if there is one, then the BLOCK
+			DO,    // GROUP, then the BLOCK
+			WITH,  // A PERMISSION_NAME each
+
+			NODE_KIND_COUNT
+		};
+
+		// Kind of a leaf that is nothing but its token, for the token types that can be one
+		struct Leaf_Kind_Table_t {
+			Node_Kind_t entries[KEY_WITH + 1] = {};
+
+			constexpr Leaf_Kind_Table_t() {
+				entries[LIT_INT]       = INT_LITERAL;
+				entries[LIT_FLOAT]     = FLOAT_LITERAL;
+				entries[LIT_DECIMAL]   = DECIMAL_LITERAL;
+				entries[LIT_CHAR]      = CHAR_LITERAL;
+				entries[LIT_STRING]    = STRING_LITERAL;
+				entries[IDENTIFIER]    = NAME;
+				entries[DOUBLE_COLON]  = ROOT;
+				entries[ARROW]         = STACK_ARROW;
+				entries[PLUS]          = OPERATOR_WORD;
+				entries[LEFT_CARROT]   = OPERATOR_WORD;
+				entries[RIGHT_CARROT]  = OPERATOR_WORD;
+				entries[KEY_RET]       = CONTROL_WORD;
+				entries[KEY_JUMP]      = CONTROL_WORD;
+				entries[KEY_CALL]      = CONTROL_WORD;
+			}
+
+			constexpr Node_Kind_t operator[](TokenType_t t) const {
+				return entries[t];
+			}
+		};
+
+		inline constexpr Leaf_Kind_Table_t leaf_kinds;
+
+		// A syntax tree over a Token_Stream, with every node a 32 bit index into flat arrays.
+		// Nodes are only ever added at the end, so building a tree is a bump of each array, and
+		// clear() throws the whole tree away at once. The arrays keep their memory, so the next
+		// tree built in the same one doesn't allocate at all.
+		//
+		// Most nodes are leaves that are just a token, like a literal or a name. Those aren't
+		// stored anywhere: the node is the token's index with token_node set, and its kind comes
+		// from leaf_kinds. Every other node is a record of its kind, its token and where its
+		// children end.
+		//
+		// Trees are built bottom up. A node's children are made first, and are collected on a
+		// stack until close() makes the parent, which moves them into one contiguous run. A
+		// record's children are always made before it is, so its run starts where the record
+		// before it ended, and the root is the last record.
+		class Syntax_Tree {
+		  public:
+			static constexpr Node_t token_node = Node_t{1} << 31;
+
+			// The stack height when a node was opened, saying which children are its own
+			using Mark_t = uint32_t;
+
+			struct Children_t {
+				const Node_t* first;
+				const Node_t* last;
+				const Node_t* begin() const {
+					return first;
+				}
+				const Node_t* end() const {
+					return last;
+				}
+				size_t size() const {
+					return static_cast<size_t>(last - first);
+				}
+				Node_t operator[](size_t i) const {
+					return first[i];
+				}
+			};
+
+			void set_tokens(const nip::Token_Stream* t) {
+				tokens = t;
+			}
+
+			ALWAYS_INLINE Mark_t open() const {
+				return static_cast<Mark_t>(pending.size());
+			}
+			// The leaf that is the token at index
+			ALWAYS_INLINE Node_t leaf(size_t index) {
+				Node_t n = static_cast<Node_t>(index) | token_node;
+				pending.push_back(n);
+				return n;
+			}
+			// A leaf of a kind leaf_kinds doesn't give
+			ALWAYS_INLINE Node_t leaf(Node_Kind_t k, size_t index) {
+				Node_t n = add(k, index);
+				pending.push_back(n);
+				return n;
+			}
+			// Makes a node of everything made since m
+			ALWAYS_INLINE Node_t close(Mark_t m, Node_Kind_t k, size_t index) {
+				children.append(pending.data() + m, pending.size() - m);
+				pending.resize(m);
+				Node_t n = add(k, index);
+				pending.push_back(n);
+				return n;
+			}
+
+			// Moves everything made in part to the end of this tree, as if it had been made here
+			// after what is already. Part's nodes keep their order and its pending ones stay
+			// pending, so trees of consecutive pieces of one stream can be built apart and joined.
+			void append(const Syntax_Tree& part);
+
+			// Sizes the arrays for a tree made from this many tokens
+			void reserve(size_t token_count);
+			void clear() {
+				nodes.clear();
+				children.clear();
+				pending.clear();
+			}
+
+			// Every node made, counting the leaves that are only tokens
+			size_t size() const {
+				return children.size() + pending.size();
+			}
+			bool empty() const {
+				return nodes.size() == 0;
+			}
+			Node_t root() const {
+				return static_cast<Node_t>(nodes.size() - 1);
+			}
+
+			ALWAYS_INLINE Node_Kind_t kind(Node_t n) const {
+				return n & token_node ? leaf_kinds[tokens->type(n & ~token_node)] : nodes[n].kind;
+			}
+			// Index of the node's token in the stream
+			ALWAYS_INLINE uint32_t token(Node_t n) const {
+				return n & token_node ? n & ~token_node : nodes[n].token;
+			}
+			ALWAYS_INLINE uint32_t offset(Node_t n) const {
+				return tokens->offset(token(n));
+			}
+			ALWAYS_INLINE uint32_t payload(Node_t n) const {
+				return tokens->payload(token(n));
+			}
+			ALWAYS_INLINE Children_t operator[](Node_t n) const {
+				const Node_t* base = children.data();
+				if (n & token_node) {
+					return {base, base};
+				}
+				return {base + (n ? nodes[n - 1].end : 0), base + nodes[n].end};
+			}
+
+			// Prints the tree below n, one node a line, indented by depth
+			void print(std::ostream& os, const Token_Cache_t& tc, Node_t n, size_t depth = 0) const;
+
+		  private:
+			// Where the nodes live. Unlike a std::vector it never initializes what it grows into,
+			// and its appends stay inline, since building a tree is little else.
+			template <class T>
+			class Arena_t {
+				static_assert(std::is_trivially_copyable_v<T>, "arenas are moved with realloc");
+
+			  public:
+				Arena_t() = default;
+				Arena_t(const Arena_t&) = delete;
+				Arena_t& operator=(const Arena_t&) = delete;
+				~Arena_t() {
+					std::free(first);
+				}
+
+				ALWAYS_INLINE void push_back(const T& value) {
+					if (last == capacity) {
+						grow(1);
+					}
+					*last++ = value;
+				}
+				// Runs of children are mostly one to three long, where a call to memcpy costs more
+				// than the copy
+				ALWAYS_INLINE void append(const T* values, size_t count) {
+					if (static_cast<size_t>(capacity - last) < count) {
+						grow(count);
+					}
+					for (size_t i = 0; i < count; i++) {
+						last[i] = values[i];
+					}
+					last += count;
+				}
+				// Only ever shrinks
+				ALWAYS_INLINE void resize(size_t count) {
+					last = first + count;
+				}
+				void clear() {
+					last = first;
+				}
+				void reserve(size_t count) {
+					if (static_cast<size_t>(capacity - first) < count) {
+						grow(count - size());
+					}
+				}
+
+				ALWAYS_INLINE size_t size() const {
+					return static_cast<size_t>(last - first);
+				}
+				ALWAYS_INLINE T* data() const {
+					return first;
+				}
+				// Makes room for count more at the end, left uninitialized, and returns it
+				T* extend(size_t count) {
+					if (static_cast<size_t>(capacity - last) < count) {
+						grow(count);
+					}
+					T* added = last;
+					last += count;
+					return added;
+				}
+				ALWAYS_INLINE const T& operator[](size_t i) const {
+					return first[i];
+				}
+
+			  private:
+				NEVER_INLINE void grow(size_t count) {
+					size_t used     = size();
+					size_t doubled  = static_cast<size_t>(capacity - first) * 2;
+					size_t required = used + count;
+					size_t total    = doubled > required ? doubled : required;
+					T* moved        = static_cast<T*>(std::realloc(first, total * sizeof(T)));
+					if (!moved) {
+						throw std::bad_alloc();
+					}
+					first    = moved;
+					last     = moved + used;
+					capacity = moved + total;
+				}
+
+				T* first    = nullptr;
+				T* last     = nullptr;
+				T* capacity = nullptr;
+			};
+
+			struct Node_Data_t {
+				uint32_t token;
+				uint32_t end; // Of its children, which start at the end of the record before
+				Node_Kind_t kind;
+			};
+
+			ALWAYS_INLINE Node_t add(Node_Kind_t k, size_t index) {
+				uint32_t end = static_cast<uint32_t>(children.size());
+				nodes.push_back({static_cast<uint32_t>(index), end, k});
+				return static_cast<Node_t>(nodes.size() - 1);
+			}
+
+			const nip::Token_Stream* tokens = nullptr;
+			Arena_t<Node_Data_t> nodes;
+			Arena_t<Node_t> children; // Every node's children, back to back
+			Arena_t<Node_t> pending;  // Made but not yet given a parent
+		};
+
+		const char* kind_name(Node_Kind_t k);
+	}
+}
@@ -1,4 +1,5 @@
 #include "errorhandler.hpp"
+#include "../Lexer/utf8.hpp"
 #include "../util.hpp"
 
 #include <algorithm>
@@ -9,8 +10,12 @@ void nip::error::Error_Handler::print_errors(std::ostream& out) {
 	sort();
 
 	for (_Error e : error_list) {
-		out << nip::color::print(nip::color::FG_WHITE, nip::color::BOLD) << e.loc_line << ":"
-		    << e.loc_char << ": ";
+		nip::Source_Location_t loc{0, 0};
+		if (e.has_location && source_file) {
+			loc = source_file->locate(e.offset);
+		}
+		out << nip::color::print(nip::color::FG_WHITE, nip::color::BOLD) << loc.line << ":"
+		    << loc.column << ": ";
 		switch (e.type) {
 			case NOTE:
 				out << nip::color::print(nip::color::FG_CYAN, nip::color::BOLD) << "note: ";
@@ -24,14 +29,42 @@ void nip::error::Error_Handler::print_errors(std::ostream& out) {
 				break;
 		}
 		out << nip::color::print(nip::color::RESET) << e.msg << "\n";
+
+		// Quote the offending line straight out of the source buffer, with a caret under the
+		// column. Tabs are kept in the caret line so it stays aligned, and every other character
+		// takes one space however many bytes it is.
+		if (e.has_location && source_file) {
+			std::string_view line = source_file->line(loc.line);
+			out << line << '\n';
+			size_t column = 1;
+			for (size_t i = 0; i < line.size() && column < loc.column; i++) {
+				if (!nip::utf8::is_continuation(line[i])) {
+					out << (line[i] == '\t' ? '\t' : ' ');
+					column++;
+				}
+			}
+			out << "^\n";
+		}
+	}
+}
+
+void nip::error::Error_Handler::splice(size_t first, size_t last, const Error_Handler& with,
+                                       std::ptrdiff_t shift) {
+	for (auto e = error_list.begin() + last; e != error_list.end(); ++e) {
+		e->offset += shift;
 	}
+	nip::util::replace_range(error_list, first, last - first, with.error_list.begin(),
+	                         with.error_list.end());
+	has_note |= with.has_note;
+	has_warning |= with.has_warning;
+	has_error |= with.has_error;
+	has_fatal |= with.has_fatal;
 }
 
 void nip::error::Error_Handler::sort() {
 	if (!sorted) {
 		std::sort(error_list.begin(), error_list.end(), [](auto left, auto right) {
-			return (left.loc_line < right.loc_line ||
-			        (left.loc_line == right.loc_line && left.loc_char < right.loc_char));
+			return left.offset < right.offset;
 		});
 	}
 }
\ No newline at end of file
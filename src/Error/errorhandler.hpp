@@ -1,7 +1,9 @@
 #pragma once
 
+#include "../sourcebuffer.hpp"
 #include "../utilmacro.hpp"
 
+#include <cstddef>
 #include <iosfwd>
 #include <string>
 #include <vector>
@@ -10,36 +12,45 @@ namespace nip {
 	namespace error {
 		enum _Error_Type : uint8_t { NOTE, WARNING, ERROR, FATAL_ERROR };
 
+		// Errors point at a byte offset in the source, which is only turned into a line and
+		// column when they are printed
 		struct _Error {
-			_Error(_Error_Type type_i, const char* msg_i, size_t ll = 0, size_t lc = 0,
-			       bool hl = false)
-			    : msg(msg_i), loc_line(ll), loc_char(lc), has_location(hl), type(type_i) {}
+			_Error(_Error_Type type_i, const char* msg_i, size_t off = 0, bool hl = false)
+			    : msg(msg_i), offset(off), has_location(hl), type(type_i) {}
 			std::string msg;
-			size_t loc_line;
-			size_t loc_char;
+			size_t offset;
 			bool has_location;
 			_Error_Type type;
 		};
 
 		class Error_Handler {
 		  public:
-			ALWAYS_INLINE void add_error(_Error_Type type, std::string& msg, size_t ll = 0,
-			                             size_t lc = 0, bool hl = false);
-			ALWAYS_INLINE void add_error(_Error_Type type, const char* msg, size_t ll = 0,
-			                             size_t lc = 0, bool hl = false);
+			ALWAYS_INLINE void add_error(_Error_Type type, std::string& msg, size_t off = 0,
+			                             bool hl = false);
+			ALWAYS_INLINE void add_error(_Error_Type type, const char* msg, size_t off = 0,
+			                             bool hl = false);
 			void print_errors(std::ostream&);
+			size_t size() const {
+				return error_list.size();
+			}
+			const std::vector<_Error>& errors() const {
+				return error_list;
+			}
+			// Replaces errors [first, last), in the order they were added, with the errors of
+			// with, and moves the offsets of the ones after by shift bytes
+			void splice(size_t first, size_t last, const Error_Handler& with, std::ptrdiff_t shift);
 
 			Error_Handler(){};
-			Error_Handler(std::vector<std::string>&& source) : source_file(source){};
-			void set_source(std::vector<std::string>&& source) {
-				source_file = source;
+			Error_Handler(const nip::Source_Buffer& source) : source_file(&source){};
+			void set_source(const nip::Source_Buffer& source) {
+				source_file = &source;
 			};
 
 		  private:
 			void sort();
 
 			std::vector<_Error> error_list;
-			std::vector<std::string> source_file;
+			const nip::Source_Buffer* source_file = nullptr;
 
 			bool has_note    = false;
 			bool has_warning = false;
@@ -51,13 +62,13 @@ namespace nip {
 }
 
 ALWAYS_INLINE void nip::error::Error_Handler::add_error(_Error_Type type, std::string& msg,
-                                                        size_t ll, size_t lc, bool hl) {
-	add_error(type, msg.data(), ll, lc, hl);
+                                                        size_t off, bool hl) {
+	add_error(type, msg.data(), off, hl);
 }
 
 ALWAYS_INLINE void nip::error::Error_Handler::add_error(_Error_Type type, const char* msg,
-                                                        size_t ll, size_t lc, bool hl) {
-	error_list.emplace_back(type, msg, ll, lc, hl);
+                                                        size_t off, bool hl) {
+	error_list.emplace_back(type, msg, off, hl);
 	switch (type) {
 		case NOTE:
 			has_note = true;
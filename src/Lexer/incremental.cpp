@@ -0,0 +1,84 @@
+#include "incremental.hpp"
+#include "../util.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+nip::lex::Incremental_Lexer::Incremental_Lexer(nip::Source_Buffer& src, nip::Token_Cache_t& tc,
+                                               nip::error::Error_Handler& e)
+    : source(src), token_caches(tc), errhdlr(e) {
+	// An edit moves the text under a string literal's view, so every literal is decoded
+	token_caches.string.set_source(nullptr);
+	Lexer lexer(source, token_caches, errhdlr);
+	save(checkpoints, lexer, 0, errhdlr.size());
+	while (lexer.run_line(stream)) {
+		save(checkpoints, lexer, stream.size(), errhdlr.size());
+	}
+	last_relexed = source.size();
+}
+
+void nip::lex::Incremental_Lexer::save(std::vector<Checkpoint_t>& to, const Lexer& lexer,
+                                       size_t token_base, size_t error_base) {
+	const Indentation_t& state = lexer.indentation_state();
+	if (states.empty() || states.back() != state) {
+		states.push_back(state);
+	}
+	to.push_back({static_cast<size_t>(lexer.position() - source.begin()),
+	              static_cast<uint32_t>(token_base), static_cast<uint32_t>(error_base),
+	              static_cast<uint32_t>(states.size() - 1)});
+}
+
+void nip::lex::Incremental_Lexer::edit(size_t offset, size_t count, std::string_view text) {
+	// Checkpoints are only valid while the text before them stays the same
+	auto start = std::prev(std::upper_bound(
+	    checkpoints.begin(), checkpoints.end(), offset,
+	    [](size_t off, const Checkpoint_t& c) { return off < c.offset; }));
+	Checkpoint_t from = *start;
+
+	std::ptrdiff_t byte_shift = text.size() - count;
+	source.edit(offset, count, text);
+
+	// The first checkpoint entirely past the edit that the lexer reaches in the same state is
+	// where the old tokens take over again
+	auto candidate = std::lower_bound(
+	    start + 1, checkpoints.end(), offset + count,
+	    [](const Checkpoint_t& c, size_t off) { return c.offset < off; });
+	auto moved = [byte_shift](const Checkpoint_t& c) { return c.offset + byte_shift; };
+
+	nip::Token_Stream with;
+	nip::error::Error_Handler errors;
+	std::vector<Checkpoint_t> added;
+	Lexer lexer(source, token_caches, errors);
+	lexer.restart(source.begin() + from.offset, states[from.state], from.token == 0);
+	bool resynced = false;
+	while (lexer.run_line(with)) {
+		size_t at = lexer.position() - source.begin();
+		while (candidate != checkpoints.end() && moved(*candidate) < at) {
+			++candidate;
+		}
+		if (candidate != checkpoints.end() && moved(*candidate) == at &&
+		    states[candidate->state] == lexer.indentation_state() &&
+		    (candidate->token == 0) == (from.token + with.size() == 0)) {
+			resynced = true;
+			break;
+		}
+		save(added, lexer, from.token + with.size(), from.error + errors.size());
+	}
+	last_relexed = lexer.position() - (source.begin() + from.offset);
+
+	size_t token_last = resynced ? candidate->token : stream.size();
+	size_t error_last = resynced ? candidate->error : errhdlr.size();
+	std::ptrdiff_t token_shift = from.token + with.size() - token_last;
+	std::ptrdiff_t error_shift = from.error + errors.size() - error_last;
+	stream.splice(from.token, token_last, with, byte_shift);
+	errhdlr.splice(from.error, error_last, errors, byte_shift);
+
+	auto tail = resynced ? candidate : checkpoints.end();
+	for (auto c = tail; c != checkpoints.end(); ++c) {
+		c->offset += byte_shift;
+		c->token += token_shift;
+		c->error += error_shift;
+	}
+	nip::util::replace_range(checkpoints, start + 1 - checkpoints.begin(), tail - (start + 1),
+	                         added.begin(), added.end());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "lexer.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace nip {
+	namespace lex {
+		// Keeps the tokens of a source up to date as it is edited, for an editor or a watch loop.
+		// A checkpoint is saved at every line start where the lexer holds no state besides its
+		// indentation. An edit is lexed again from the last checkpoint before it, until the lexer
+		// reaches a checkpoint past the edit in the same state, after which the old tokens are
+		// still right and only have to move. Errors are kept in the order they were raised, so the
+		// error handler must only be written to by this lexer, and not printed between edits.
+		//
+		// Identifiers and numbers are interned again, which gives back the ids they had. String
+		// literals and decimals from the lexed again lines are appended to their tables, leaving
+		// the old entries unused. String literals are always decoded, since the source moves under
+		// them.
+		class Incremental_Lexer {
+		  public:
+			Incremental_Lexer(nip::Source_Buffer& src, nip::Token_Cache_t& tc,
+			                  nip::error::Error_Handler& e);
+
+			// Replaces count bytes at offset with text, in the source as well as the tokens
+			void edit(size_t offset, size_t count, std::string_view text);
+
+			const nip::Token_Stream& tokens() const {
+				return stream;
+			}
+			// Bytes lexed by the last edit, to tell how far it had to go
+			size_t relexed() const {
+				return last_relexed;
+			}
+
+		  private:
+			struct Checkpoint_t {
+				size_t offset;
+				uint32_t token;
+				uint32_t error;
+				uint32_t state; // Index into states
+			};
+
+			void save(std::vector<Checkpoint_t>& to, const Lexer& lexer, size_t token_base,
+			          size_t error_base);
+
+			nip::Source_Buffer& source;
+			nip::Token_Cache_t& token_caches;
+			nip::error::Error_Handler& errhdlr;
+
+			nip::Token_Stream stream;
+			std::vector<Checkpoint_t> checkpoints;
+			// Most lines leave the indentation as it was, so checkpoints share their states
+			std::vector<Indentation_t> states;
+			size_t last_relexed = 0;
+		};
+	}
+}
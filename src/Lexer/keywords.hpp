@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../token.hpp"
+#include "../utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Keyword recognition without allocating or hashing through a generic map. Every keyword is
+// told apart by its length, first and last character, so those three are mixed into a slot of a
+// small table. The mixing constants are searched for at compile time until no two keywords share
+// a slot, which makes a lookup one multiply, one load and one short compare.
+namespace nip {
+	namespace lex {
+		struct Keyword_t {
+			std::string_view word;
+			TokenType_t type;
+		};
+
+		inline constexpr Keyword_t keywords[] = {
+		    //
+		    {"about", KEY_ABOUT},
+		    {"call", KEY_CALL},
+		    {"case", KEY_CASE},
+		    {"define", KEY_DEFINE},
+		    {"do", KEY_DO},
+		    {"docs", KEY_DOCS},
+		    {"elif", KEY_ELIF},
+		    {"else", KEY_ELSE},
+		    {"if", KEY_IF},
+		    {"instance", KEY_INSTANCE},
+		    {"intrinsic", KEY_INTRIN},
+		    {"jump", KEY_JUMP},
+		    {"left", KEY_LEFT},
+		    {"match", KEY_MATCH},
+		    {"operator", KEY_OP},
+		    {"permission", KEY_PERMIT},
+		    {"return", KEY_RET},
+		    {"right", KEY_RIGHT},
+		    {"synonym", KEY_SYNONYM},
+		    {"trait", KEY_TRAIT},
+		    {"type", KEY_TYPE},
+		    {"vocab", KEY_VOCAB},
+		    {"with", KEY_WITH}
+		    //
+		};
+
+		inline constexpr size_t keyword_count      = sizeof(keywords) / sizeof(keywords[0]);
+		inline constexpr size_t keyword_table_size = 64;
+
+		struct Keyword_Hash_t {
+			uint32_t multiplier;
+			uint32_t shift;
+
+			constexpr size_t operator()(std::string_view s) const {
+				uint32_t key = static_cast<unsigned char>(s.front()) |
+				               static_cast<unsigned char>(s.back()) << 8 |
+				               static_cast<uint32_t>(s.size()) << 16;
+				return (key * multiplier) >> shift & (keyword_table_size - 1);
+			}
+		};
+
+		struct Keyword_Table_t {
+			Keyword_Hash_t hash = {0, 0};
+			size_t min_length   = ~size_t{0};
+			size_t max_length   = 0;
+			uint8_t slots[keyword_table_size] = {}; // Index into keywords + 1, 0 if empty
+
+			constexpr Keyword_Table_t() {
+				for (auto& k : keywords) {
+					min_length = k.word.size() < min_length ? k.word.size() : min_length;
+					max_length = k.word.size() > max_length ? k.word.size() : max_length;
+				}
+				for (uint32_t multiplier = 1; multiplier < 1u << 16; multiplier += 2) {
+					for (uint32_t shift = 0; shift < 26; shift++) {
+						if (try_hash({multiplier, shift})) {
+							return;
+						}
+					}
+				}
+			}
+
+			constexpr bool try_hash(Keyword_Hash_t h) {
+				for (auto& s : slots) {
+					s = 0;
+				}
+				for (size_t i = 0; i < keyword_count; i++) {
+					uint8_t& s = slots[h(keywords[i].word)];
+					if (s != 0) {
+						return false;
+					}
+					s = static_cast<uint8_t>(i + 1);
+				}
+				hash = h;
+				return true;
+			}
+		};
+
+		inline constexpr Keyword_Table_t keyword_table;
+		static_assert(keyword_table.hash.multiplier != 0, "no perfect hash for the keyword set");
+
+		// Returns the keyword token for s, or IDENTIFIER if s isn't a keyword
+		ALWAYS_INLINE constexpr TokenType_t classify_keyword(std::string_view s) {
+			if (s.size() < keyword_table.min_length || s.size() > keyword_table.max_length) {
+				return IDENTIFIER;
+			}
+			uint8_t slot = keyword_table.slots[keyword_table.hash(s)];
+			if (slot != 0 && keywords[slot - 1].word == s) {
+				return keywords[slot - 1].type;
+			}
+			return IDENTIFIER;
+		}
+	}
+}
@@ -0,0 +1,598 @@
+#include "lexer.hpp"
+#include "keywords.hpp"
+#include "number.hpp"
+#include "utf8.hpp"
+
+#include <cstring>
+#include <string_view>
+
+using namespace std::string_literals;
+
+namespace {
+	// How far ahead of the lexer malformed UTF-8 is searched for at a time
+	constexpr size_t utf8_block = 1 << 16;
+
+	bool is_number(char c) {
+		return (('0' <= c && c <= '9') || c == '.');
+	}
+}
+
+nip::lex::Lexer::Lexer(nip::Source_Buffer& src, nip::Token_Cache_t& tc,
+                       nip::error::Error_Handler& e)
+    : source(src), token_caches(tc), errhdlr(e), scan(nip::scan::kernels()), cur(src.begin()),
+      eof(src.end()){};
+
+bool nip::lex::Lexer::next(nip::Token_t& out) {
+	while (pending.empty() && !done) {
+		step();
+	}
+	if (pending.empty()) {
+		return false;
+	}
+	out = pending.front();
+	pending.pop_front();
+	return true;
+}
+
+void nip::lex::Lexer::run(nip::Token_Stream& out) {
+	sink = &out;
+	while (!done) {
+		step();
+	}
+	sink = nullptr;
+}
+
+void nip::lex::Lexer::run_chunk(const char* first, const char* last, nip::Token_Stream& out,
+                                std::vector<Indent_Mark_t>& m) {
+	cur   = first;
+	sink  = &out;
+	marks = &m;
+	reset_utf8(source.offset(first));
+	resume(last);
+}
+
+void nip::lex::Lexer::resume(const char* last) {
+	while (!done && cur < last) {
+		step();
+	}
+	// A chunk stops short of the finish() a whole run ends with, but a last line without a
+	// newline still has its errors to raise
+	if (!done && cur == eof) {
+		report_utf8(~size_t{0});
+	}
+}
+
+bool nip::lex::Lexer::clean_break() const {
+	return state == LINE_START && (last_type == NUL || last_type == NEWLINE);
+}
+
+void nip::lex::Lexer::restart(const char* at, const Indentation_t& saved, bool first) {
+	cur         = at;
+	eof         = source.end();
+	indentation = saved;
+	state       = LINE_START;
+	done        = false;
+	last_type   = first ? NUL : NEWLINE;
+	reset_utf8(source.offset(at));
+}
+
+// The end of the source never counts as a line start, since a comment or string left open there
+// would carry on into anything appended
+bool nip::lex::Lexer::run_line(nip::Token_Stream& out) {
+	sink = &out;
+	do {
+		step();
+	} while (!done && !(cur != source.begin() && cur != eof && cur[-1] == '\n' && clean_break()));
+	sink = nullptr;
+	return !done;
+}
+
+void nip::lex::Lexer::reset_utf8(size_t from) {
+	utf8_validated = from;
+	utf8_next      = from;
+	utf8_errors.clear();
+	utf8_raised = 0;
+}
+
+void nip::lex::Lexer::report_utf8(size_t upto) {
+	while (true) {
+		for (; utf8_raised < utf8_errors.size() && utf8_errors[utf8_raised] < upto; utf8_raised++) {
+			errhdlr.add_error(nip::error::ERROR, "malformed UTF-8", utf8_errors[utf8_raised], true);
+		}
+		if (utf8_raised < utf8_errors.size()) {
+			utf8_next = utf8_errors[utf8_raised];
+			return;
+		}
+		utf8_errors.clear();
+		utf8_raised = 0;
+		if (utf8_validated > upto || !validate_utf8()) {
+			utf8_next = utf8_validated;
+			return;
+		}
+	}
+}
+
+// Searches the next block of the window for malformed UTF-8, stopping on a line start so the
+// search never starts inside a character. A run of bad bytes is one error. Returns false if
+// the whole window was searched already.
+bool nip::lex::Lexer::validate_utf8() {
+	const char* first = source.at(utf8_validated);
+	if (first == eof) {
+		return false;
+	}
+	const char* last = eof;
+	if (size_t(eof - first) > utf8_block) {
+		last = scan.find_either(first + utf8_block, eof, '\n', '\n');
+		last += last != eof;
+	}
+	const char* run_end = nullptr;
+	for (const char* p = first; (p = scan.utf8_invalid(p, last)) != last;) {
+		if (p != run_end) {
+			utf8_errors.push_back(source.offset(p));
+		}
+		run_end = ++p;
+	}
+	utf8_validated = source.offset(last);
+	return true;
+}
+
+// Streamed sources are read a window at a time. The window always ends on a line boundary, so
+// this only ever happens between lines, or inside a token that spans several of them.
+bool nip::lex::Lexer::refill() {
+	if (!source.streaming()) {
+		return false;
+	}
+	report_utf8(source.offset(eof));
+	bool more = source.refill(cur);
+	cur       = source.begin();
+	eof       = source.end();
+	if (!more && source.too_large()) {
+		errhdlr.add_error(nip::error::FATAL_ERROR,
+		                  "input is 4 GiB or larger, which is too large");
+	}
+	return more;
+}
+
+void nip::lex::Lexer::finish() {
+	// The last line doesn't need a trailing newline to be terminated
+	if (last_type != NUL && last_type != NEWLINE) {
+		emit(NEWLINE, source.offset(cur));
+	}
+	report_utf8(~size_t{0});
+	done = true;
+}
+
+// Eats a /* */ comment whose opening slash is curchar
+void nip::lex::Lexer::skip_block_comment() {
+	advance_char();
+	while (true) {
+		advance_to(scan.find_either(cur, eof, '*', '*'));
+		if (!advance_char()) {
+			break;
+		}
+		if (peek() == '/') {
+			advance_char();
+			break;
+		}
+	}
+}
+
+void nip::lex::Lexer::skip_line_comment() {
+	advance_to(scan.find_either(cur, eof, '\n', '\n'));
+}
+
+// Lines holding nothing but whitespace or a comment never change the indentation level. This
+// looks ahead from curchar, the first character of a line, and eats the line if it is one.
+bool nip::lex::Lexer::skip_blank_line() {
+	const char* p = cur - 1;
+	while (p != eof) {
+		if (*p == ' ' || *p == '\t') {
+			p++;
+		}
+		else if (size_t length = nip::utf8::space_length(p, eof)) {
+			p += length;
+		}
+		else {
+			break;
+		}
+	}
+	bool line_comment  = eof - p >= 2 && p[0] == '/' && p[1] == '/';
+	bool block_comment = eof - p >= 2 && p[0] == '/' && p[1] == '*';
+	if (p != eof && *p != '\n' && !line_comment && !block_comment) {
+		return false;
+	}
+	// Then the indentation is what came before the comment
+	if (block_comment && code_after_comment(p)) {
+		return false;
+	}
+	if (block_comment) {
+		while (cur <= p) {
+			advance_char();
+		}
+		skip_block_comment();
+	}
+	else {
+		skip_line_comment();
+	}
+	return true;
+}
+
+// Whether the line goes on with code after the /* */ comment opening at p. A comment that runs
+// past the window is taken to end the line, as the code after it can't be seen yet.
+bool nip::lex::Lexer::code_after_comment(const char* p) const {
+	while (true) {
+		const char* close = p + 2;
+		do {
+			close = scan.find_either(close, eof, '*', '*');
+			if (eof - close < 2) {
+				return false;
+			}
+			close++;
+		} while (*close != '/');
+		p = close + 1;
+		while (p != eof) {
+			if (*p == ' ' || *p == '\t') {
+				p++;
+			}
+			else if (size_t length = nip::utf8::space_length(p, eof)) {
+				p += length;
+			}
+			else {
+				break;
+			}
+		}
+		if (eof - p < 2 || p[0] != '/' || p[1] != '*') {
+			return p != eof && *p != '\n' && !(eof - p >= 2 && p[0] == '/' && p[1] == '/');
+		}
+	}
+}
+
+// Updates the indentation level for the line just started. Chunks leave this for later.
+void nip::lex::Lexer::indent(Indent_Kind_t kind, size_t ic) {
+	Indent_Mark_t m{sink ? sink->size() : 0, errhdlr.size(), kind, ic, here()};
+	state = CODE;
+	if (marks) {
+		// A line indented just like the last one marked changes nothing
+		if (marks->empty() || marks->back().kind != kind || marks->back().width != ic) {
+			marks->push_back(m);
+		}
+	}
+	else if (!indentation.apply(m, errhdlr, [this](TokenType_t t, size_t off) {
+		         emit(t, off);
+	         })) {
+		done = true;
+	}
+}
+
+char nip::lex::Lexer::escaper(char c) {
+	char out = '\0';
+	switch (c) {
+		case 'a':
+			out = '\a';
+			break;
+		case 'b':
+			out = '\b';
+			break;
+		case 'f':
+			out = '\f';
+			break;
+		case 'n':
+			out = '\n';
+			break;
+		case 'r':
+			out = '\r';
+			break;
+		case 't':
+			out = '\t';
+			break;
+		case 'v':
+			out = '\v';
+			break;
+		case '\0':
+			out = '\0';
+			break;
+		case '\\':
+			out = '\\';
+			break;
+		case '\'':
+			out = '\'';
+			break;
+		case '\"':
+			out = '\"';
+			break;
+		case '\?':
+			out = '\?';
+			break;
+		default: {
+			errhdlr.add_error(nip::error::ERROR, ("improper escape code \\"s + c).data(), here(),
+			                  true);
+			break;
+		}
+	}
+	return out;
+}
+
+// Decodes a string literal into the literal arena
+void nip::lex::Lexer::str_advance(bool single_quote) {
+	nip::Literal_Table& output = token_caches.string;
+	bool escaped               = false;
+	while (true) {
+		if (single_quote && !escaped && peek() == '\n') {
+			// Leave the newline for the main loop to turn into a token
+			errhdlr.add_error(nip::error::ERROR, "unterminated string literal", source.offset(cur),
+			                  true);
+			break;
+		}
+		if (!advance_char()) {
+			errhdlr.add_error(nip::error::ERROR, "unterminated string literal", here(), true);
+			break;
+		}
+		if (escaped) {
+			output.put(escaper(curchar));
+			escaped = false;
+		}
+		else if (curchar == '\\') {
+			escaped = true;
+		}
+		else if (curchar == '\n') {
+			output.put(curchar);
+		}
+		else if (curchar == '"' && single_quote) {
+			break;
+		}
+		else if (curchar == '"' && peek() == '"' && peek(1) == '"') {
+			advance_char();
+			advance_char();
+			break;
+		}
+		else {
+			output.put(curchar);
+		}
+	}
+}
+
+// A literal without escapes is its own text, so it is left where it is in the source. Returns
+// no_literal, having moved nothing, for one that has to be decoded or is left open.
+nip::Literal_t nip::lex::Lexer::view_string(bool single_quote) {
+	const char* p = cur;
+	while (true) {
+		p = scan.find_either(p, eof, '"', '\\');
+		if (p == eof || *p == '\\') {
+			return nip::Literal_Table::no_literal;
+		}
+		if (single_quote || (eof - p >= 3 && p[1] == '"' && p[2] == '"')) {
+			break;
+		}
+		p++;
+	}
+	if (single_quote && std::memchr(cur, '\n', p - cur)) {
+		return nip::Literal_Table::no_literal;
+	}
+	nip::Literal_t id = token_caches.string.view(source.offset(cur), p - cur);
+	advance_to(p + (single_quote ? 1 : 3));
+	return id;
+}
+
+void nip::lex::Lexer::lex_char() {
+	char c       = '\0';
+	size_t start = here();
+	advance_char();
+	if (curchar == '\\') {
+		advance_char();
+		c = escaper(curchar);
+	}
+	else {
+		c = curchar;
+	}
+	if (peek() == '\'') {
+		advance_char();
+	}
+	else {
+		errhdlr.add_error(nip::error::ERROR, "unterminated character literal", here(), true);
+	}
+	emit(LIT_CHAR, start, c);
+}
+
+// Both "blah" and """blah"""
+void nip::lex::Lexer::lex_string() {
+	bool single  = true;
+	size_t start = here();
+	if (peek() == '"' && peek(1) == '"') {
+		advance_char();
+		advance_char();
+		single = false;
+	}
+	nip::Literal_Table& strings = token_caches.string;
+	nip::Literal_t id           = nip::Literal_Table::no_literal;
+	if (strings.source() == &source && !source.streaming()) {
+		id = view_string(single);
+	}
+	if (id == nip::Literal_Table::no_literal) {
+		strings.open();
+		str_advance(single);
+		id = strings.close();
+	}
+	emit(LIT_STRING, start, id);
+}
+
+// The literal starts at curchar, a digit or a - before a digit or .. One that a machine type
+// can't hold as written is kept exactly, and whether it fits is left to whoever lowers it.
+void nip::lex::Lexer::lex_number() {
+	size_t start         = here();
+	nip::lex::Number_t n = nip::lex::parse_number(cur - 1, eof);
+	if (n.inexact) {
+		token_caches.decimal.emplace_back(cur - 1, n.end);
+		emit(LIT_DECIMAL, start, token_caches.decimal.size() - 1);
+	}
+	else if (n.is_float) {
+		emit(LIT_FLOAT, start, token_caches.floating_pt.intern(n.floating));
+	}
+	else {
+		emit(LIT_INT, start, token_caches.integer.intern(n.integer));
+	}
+	advance_to(n.end);
+}
+
+// The word starts at curchar. Keywords are recognized straight from the source, identifiers are
+// interned so each distinct name is only stored once.
+void nip::lex::Lexer::lex_word(bool about) {
+	const char* startptr = cur - 1;
+	// The kernel stops at every non-ASCII character, which is part of the name unless it is
+	// whitespace
+	const char* p = startptr;
+	do {
+		p = scan.identifier_end(p + nip::utf8::step_length(p, eof), eof, about);
+	} while (p != eof && !nip::utf8::is_ascii(*p) && !nip::utf8::space_length(p, eof));
+	advance_to(p);
+	std::string_view word(startptr, cur - startptr);
+	TokenType_t tt = nip::lex::classify_keyword(word);
+	if (tt == IDENTIFIER) {
+		emit(IDENTIFIER, source.offset(startptr), token_caches.identifier.intern(word));
+	}
+	else {
+		emit(tt, source.offset(startptr));
+	}
+	state = tt == KEY_ABOUT ? ABOUT : CODE;
+}
+
+// Lexes from the next character up to the end of the token it starts, or the end of the line.
+// Which token that is only depends on the state and the character, see transitions.hpp.
+void nip::lex::Lexer::step() {
+	if (!advance_char()) {
+		finish();
+		return;
+	}
+
+	const Transition_t& t = transitions(state, curchar);
+	if (t.column_one) {
+		indent(UNSET, 0);
+	}
+
+	switch (t.action) {
+		case SKIP:
+			return;
+
+		case END_LINE:
+			state = LINE_START;
+			if (last_type != NUL && last_type != NEWLINE) {
+				emit(NEWLINE, here());
+			}
+			check_utf8(here());
+			return;
+
+		case INDENT_TABS:
+		case INDENT_SPACES: {
+			if (skip_blank_line()) {
+				return;
+			}
+			const char* run = scan.run_end(cur, eof, curchar);
+			size_t ic       = 1 + (run - cur);
+			advance_to(run);
+			indent(t.action == INDENT_TABS ? TAB : SPACE, ic);
+			return;
+		}
+
+		case SPACES:
+			advance_to(scan.run_end(cur, eof, ' '));
+			return;
+
+		case SYMBOL:
+			emit(static_cast<TokenType_t>(t.token), here());
+			return;
+
+		// Comments, otherwise / starts an identifier
+		case SLASH:
+			if (peek() == '/') {
+				skip_line_comment();
+			}
+			else if (peek() == '*') {
+				// A line starting with a comment starts at column one if there is code after it
+				if (state == LINE_START && code_after_comment(cur - 1)) {
+					indent(UNSET, 0);
+				}
+				skip_block_comment();
+			}
+			else {
+				if (state == LINE_START) {
+					indent(UNSET, 0);
+				}
+				lex_word(false);
+			}
+			return;
+
+		// Arrows, negative numbers, otherwise - starts an identifier
+		case DASH:
+			if (peek() == '>') {
+				emit(ARROW, here());
+				advance_char();
+			}
+			else if (is_number(peek())) {
+				lex_number();
+			}
+			else {
+				lex_word(false);
+			}
+			return;
+
+		case COLONS:
+			if (peek() == ':') {
+				emit(DOUBLE_COLON, here());
+				advance_char();
+			}
+			else {
+				emit(COLON, here());
+			}
+			return;
+
+		case DOTS:
+			if (peek() == '.' && peek(1) == '.') {
+				emit(TRIPLE_DOT, here());
+				advance_char();
+				advance_char();
+			}
+			else {
+				emit(DOT, here());
+			}
+			return;
+
+		case ANGLE:
+			if (peek() == '>') {
+				emit(IDENTIFIER, here(), token_caches.identifier.intern("<>"));
+				advance_char();
+			}
+			else {
+				emit(LEFT_CARROT, here());
+			}
+			return;
+
+		case CHARACTER:
+			lex_char();
+			return;
+		case STRING:
+			lex_string();
+			return;
+		case NUMBER:
+			lex_number();
+			return;
+		case WORD:
+			lex_word(false);
+			return;
+		case ABOUT_WORD:
+			lex_word(true);
+			return;
+
+		// Separates tokens like a space, otherwise it starts an identifier
+		case WIDE_SPACE:
+			if (size_t length = nip::utf8::space_length(cur - 1, eof)) {
+				advance_to(cur - 1 + length);
+			}
+			else {
+				bool about = state == ABOUT;
+				if (state == LINE_START) {
+					indent(UNSET, 0);
+				}
+				lex_word(about);
+			}
+			return;
+	}
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "../Error/errorhandler.hpp"
+#include "../sourcebuffer.hpp"
+#include "../token.hpp"
+#include "../tokenstream.hpp"
+#include "../utilmacro.hpp"
+#include "scan.hpp"
+#include "transitions.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace nip {
+	namespace lex {
+		// Bump whenever a change to the lexer changes the tokens, caches or errors it produces for
+		// some source, so token streams saved by an older lexer aren't used (see Lex_Cache)
+		inline constexpr uint32_t lexer_version = 5;
+
+		enum Indent_Kind_t : uint8_t { UNSET, SPACE, TAB };
+
+		// The indentation found at the start of a line: width columns of kind ending at offset,
+		// or a line starting in column one when kind is UNSET. token and error are how many tokens
+		// and errors came before it, so the indentation can be applied after the fact (see
+		// run_parallel()).
+		struct Indent_Mark_t {
+			size_t token;
+			size_t error;
+			Indent_Kind_t kind;
+			size_t width;
+			size_t offset;
+		};
+
+		// Turns indentation marks into INDENTs and DEDENTs, checking that the indentation is
+		// consistant. Returns false after a fatal error, which ends lexing.
+		class Indentation_t {
+		  public:
+			Indentation_t(Indent_Kind_t type = UNSET) : indent_type(type){};
+
+			template <class Emit_t>
+			bool apply(const Indent_Mark_t& m, nip::error::Error_Handler& errhdlr, Emit_t emit);
+
+			bool operator==(const Indentation_t& rhs) const {
+				return curindent == rhs.curindent && indent_type == rhs.indent_type &&
+				       curindentlevels == rhs.curindentlevels;
+			}
+			bool operator!=(const Indentation_t& rhs) const {
+				return !(*this == rhs);
+			}
+
+		  private:
+			size_t curindent = 0;
+			std::vector<size_t> curindentlevels;
+			Indent_Kind_t indent_type = UNSET;
+		};
+
+		// Turns a source buffer into tokens. The lexer is pull based: next() only scans as far as
+		// it takes to produce the next token, so the parser can drive it directly and a streamed
+		// source never has to be held in memory as a whole. run() lexes everything at once into a
+		// Token_Stream, which skips the lookahead queue entirely.
+		class Lexer {
+		  public:
+			Lexer(nip::Source_Buffer& src, nip::Token_Cache_t& tc, nip::error::Error_Handler& e);
+
+			bool next(nip::Token_t& out);
+			void run(nip::Token_Stream& out);
+
+			// Chunked lexing for run_parallel(). run_chunk() lexes from first, which must start a
+			// line, until it reaches a line start at or past last. Indentation is recorded as
+			// marks instead of tokens, since it depends on the lines before first. resume() keeps
+			// going to a later last. A chunk only ends cleanly if no token or lexer state carries
+			// on past the line it stopped at, otherwise the next chunk has to be lexed again.
+			void run_chunk(const char* first, const char* last, nip::Token_Stream& out,
+			               std::vector<Indent_Mark_t>& m);
+			void resume(const char* last);
+			bool clean_break() const;
+			const char* position() const {
+				return cur;
+			}
+
+			// Incremental lexing for Incremental_Lexer. restart() picks lexing up at a line start
+			// with the state saved there, run_line() lexes up to the next line start that nothing
+			// carries over to, returning false once the source runs out.
+			void restart(const char* at, const Indentation_t& saved, bool first);
+			bool run_line(nip::Token_Stream& out);
+			const Indentation_t& indentation_state() const {
+				return indentation;
+			}
+
+		  private:
+			void step();
+			void finish();
+			bool refill();
+
+			ALWAYS_INLINE void emit(TokenType_t t, size_t off, size_t add = 0);
+			ALWAYS_INLINE size_t here() const;
+			ALWAYS_INLINE char peek(size_t ahead = 0) const;
+			ALWAYS_INLINE bool advance_char();
+			ALWAYS_INLINE void advance_to(const char* p);
+
+			void skip_block_comment();
+			void skip_line_comment();
+			bool skip_blank_line();
+			bool code_after_comment(const char* p) const;
+			void indent(Indent_Kind_t kind, size_t ic);
+			char escaper(char c);
+			void str_advance(bool single_quote);
+			nip::Literal_t view_string(bool single_quote);
+			void lex_char();
+			void lex_string();
+			void lex_number();
+			void lex_word(bool about);
+
+			ALWAYS_INLINE void check_utf8(size_t upto);
+			void report_utf8(size_t upto);
+			bool validate_utf8();
+			void reset_utf8(size_t from);
+
+			nip::Source_Buffer& source;
+			nip::Token_Cache_t& token_caches;
+			nip::error::Error_Handler& errhdlr;
+
+			// Runs of identifier characters, whitespace and comments are skipped with vectorized
+			// kernels
+			const nip::scan::Kernels_t& scan;
+
+			// The lexer scans the source buffer in place. cur always points at the next unread
+			// byte.
+			const char* cur;
+			const char* eof;
+
+			char curchar = '\0';
+			Indentation_t indentation;
+			Lex_State_t state = LINE_START;
+			bool done         = false;
+
+			TokenType_t last_type = NUL; // NUL until the first token is emitted
+
+			// Malformed UTF-8 is searched for ahead of the lexer, a block of lines at a time, but
+			// each error is only raised once the lexer finishes its line. That keeps errors in
+			// the order lines are lexed, which chunked and incremental lexing depend on.
+			size_t utf8_validated = 0; // Offset of the first byte not searched yet
+			size_t utf8_next      = 0; // Nothing to do before this offset
+			std::vector<size_t> utf8_errors;
+			size_t utf8_raised = 0; // Errors of utf8_errors already raised
+
+			// Tokens go straight into sink while run()ning, otherwise they wait in pending until
+			// next() hands them out. One step never produces more than a line's worth of DEDENTs.
+			nip::Token_Stream* sink = nullptr;
+			std::deque<nip::Token_t> pending;
+
+			// Only set while lexing a chunk
+			std::vector<Indent_Mark_t>* marks = nullptr;
+		};
+
+		// Lexes a mapped source on up to threads threads, producing exactly the tokens, caches and
+		// errors that Lexer::run() would
+		nip::Token_Stream run_parallel(nip::Source_Buffer& source, nip::Token_Cache_t& tc,
+		                               nip::error::Error_Handler& errhdlr, size_t threads);
+	}
+}
+
+ALWAYS_INLINE void nip::lex::Lexer::emit(TokenType_t t, size_t off, size_t add) {
+	last_type = t;
+	if (sink) {
+		sink->emplace_back(t, off, add);
+	}
+	else {
+		pending.emplace_back(t, off, add);
+	}
+}
+
+// Offset of curchar, the last byte read
+ALWAYS_INLINE size_t nip::lex::Lexer::here() const {
+	return source.offset(cur) - 1;
+}
+
+ALWAYS_INLINE char nip::lex::Lexer::peek(size_t ahead) const {
+	return size_t(eof - cur) > ahead ? cur[ahead] : '\0';
+}
+
+ALWAYS_INLINE bool nip::lex::Lexer::advance_char() {
+	if (cur == eof && !refill()) {
+		return false;
+	}
+	curchar = *cur++;
+	return true;
+}
+
+// Raises the UTF-8 errors before offset upto. Called once per line, so it only compares.
+ALWAYS_INLINE void nip::lex::Lexer::check_utf8(size_t upto) {
+	if (upto >= utf8_next) {
+		report_utf8(upto);
+	}
+}
+
+// Moves straight to p, which must be in the window, leaving curchar as the byte before it
+ALWAYS_INLINE void nip::lex::Lexer::advance_to(const char* p) {
+	if (p != cur) {
+		curchar = p[-1];
+		cur     = p;
+	}
+}
+
+template <class Emit_t>
+bool nip::lex::Indentation_t::apply(const Indent_Mark_t& m, nip::error::Error_Handler& errhdlr,
+                                    Emit_t emit) {
+	// Lines starting in column one close every open level
+	if (m.kind == UNSET) {
+		if (curindent > 0) {
+			curindent = 0;
+			while (curindentlevels.size()) {
+				curindentlevels.pop_back();
+				emit(DEDENT, m.offset);
+			}
+		}
+		return true;
+	}
+
+	if (indent_type != UNSET && indent_type != m.kind) {
+		errhdlr.add_error(nip::error::FATAL_ERROR,
+		                  m.kind == TAB ? "expected tab-based indentation, found spaces"
+		                                : "expected space-based indentation, found tabs",
+		                  m.offset - (m.width - 1), true);
+		return false;
+	}
+	indent_type = m.kind;
+
+	if (m.width > curindent) {
+		curindentlevels.push_back(m.width);
+		emit(INDENT, m.offset);
+	}
+	else if (m.width < curindent) {
+		while (curindentlevels.size() && curindentlevels.back() != m.width) {
+			curindentlevels.pop_back();
+			emit(DEDENT, m.offset);
+		}
+		if (curindentlevels.size() == 0) {
+			errhdlr.add_error(nip::error::ERROR, "mismatched indentation, inconsistant levels",
+			                  m.offset, true);
+		}
+	}
+	curindent = m.width;
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace nip {
+	namespace lex {
+		// A numeric literal: digits, optionally followed by a fraction and then an exponent
+		// (1, -2, 3.5, -.25, 6.02e23, 1.6e-19). Only literals with a fraction are floating point.
+		struct Number_t {
+			const char* end; // One past the literal's last character
+			bool is_float;
+			// The value doesn't fit the machine type as written: too large for an int64_t, or for
+			// a double out of the normal range or with more digits than it can give back. integer
+			// or floating is then only the nearest value, and the literal should be kept as a
+			// Decimal_t.
+			bool inexact;
+			int64_t integer;
+			double floating;
+		};
+
+		// Parses the literal starting at first, which must be a digit, or a '-' followed by a digit
+		// or '.'. Floats are correctly rounded: most take one 64x128 bit multiply, and the rare ones
+		// that can't be told apart from a halfway case that way go through strtod.
+		Number_t parse_number(const char* first, const char* last);
+	}
+}
@@ -0,0 +1,303 @@
+#include "lexer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace {
+	struct Chunk_t {
+		const char* first = nullptr;
+		const char* last  = nullptr;
+
+		// Filled by the chunk's own lexer. Offsets are into the whole file already.
+		nip::Token_Stream tokens;
+		nip::Token_Cache_t caches;
+		nip::error::Error_Handler errors;
+		std::vector<nip::lex::Indent_Mark_t> marks;
+		std::unique_ptr<nip::lex::Lexer> lexer;
+		bool skipped = false; // Lexed as the tail of an earlier chunk, or past a fatal error
+
+		// Indentation going in and out of the chunk, and the errors it raises
+		nip::lex::Indentation_t entry, exit;
+		bool resets = false; // Has a line starting in column one, after which exit is known
+		bool fatal  = false;
+		nip::error::Error_Handler indent_errors;
+		std::vector<size_t> indent_error_at; // How many chunk errors came before each of them
+
+		// Where the chunk lands in the whole file
+		size_t keep         = 0; // Tokens before a fatal error, or all of them
+		size_t string_base  = 0;
+		size_t decimal_base = 0;
+		std::vector<nip::Symbol_t> symbols;
+		std::vector<nip::Constant_t> integers, floats;
+		std::vector<std::pair<size_t, nip::Token_t>> indents; // INDENTs and DEDENTs by position
+
+		size_t out_first = 0; // Where the chunk's tokens go in the output
+	};
+
+	// Runs fn on every chunk, each on its own thread
+	template <class Fn_t>
+	void for_each_chunk(std::vector<Chunk_t>& chunks, Fn_t fn) {
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < chunks.size(); i++) {
+			workers.emplace_back(fn, std::ref(chunks[i]));
+		}
+		fn(chunks[0]);
+		for (std::thread& w : workers) {
+			w.join();
+		}
+	}
+}
+
+// Every chunk is lexed on its own thread as if it started the file, with its own caches and
+// errors. A short pass in order then works out what depends on the chunks before: indentation
+// marks are replayed into INDENTs and DEDENTs, identifiers are interned again in order of first
+// appearance so they get the ids a serial run would give them, and cache indices get their
+// offsets. The chunks are then rewritten in parallel again, straight into the output.
+nip::Token_Stream nip::lex::run_parallel(nip::Source_Buffer& source, nip::Token_Cache_t& tc,
+                                         nip::error::Error_Handler& errhdlr, size_t threads) {
+	// Split at the first line start after each even share of the file
+	std::vector<Chunk_t> chunks(threads);
+	const char* first = source.begin();
+	for (size_t i = 0; i < threads; i++) {
+		const char* last = source.end();
+		if (i + 1 < threads) {
+			last = std::max(first, source.begin() + source.size() * (i + 1) / threads);
+			auto newline = static_cast<const char*>(std::memchr(last, '\n', source.end() - last));
+			last         = newline ? newline + 1 : source.end();
+		}
+		chunks[i].first = first;
+		chunks[i].last  = last;
+		first           = last;
+	}
+
+	for_each_chunk(chunks, [&source, &tc](Chunk_t& c) {
+		c.caches.string.set_source(tc.string.source());
+		c.lexer = std::make_unique<Lexer>(source, c.caches, c.errors);
+		c.lexer->run_chunk(c.first, c.last, c.tokens, c.marks);
+	});
+
+	// A split can land inside a block comment or a multi-line string. The chunk before it then
+	// runs past its end, so it carries on over the next chunk, whose own tokens are thrown away.
+	size_t owner = 0;
+	for (size_t i = 1; i < threads; i++) {
+		Lexer& lexer = *chunks[owner].lexer;
+		if (lexer.position() == chunks[i].first && lexer.clean_break()) {
+			owner = i;
+		}
+		else {
+			lexer.resume(chunks[i].last);
+			chunks[i].skipped = true;
+		}
+	}
+
+	// Indentation is replayed in parallel as well. The first indented line sets the style, so the
+	// first line indented the other way is the fatal error, wherever it is. A line starting in
+	// column one closes every level, so from the last one on a chunk's indentation no longer
+	// depends on the chunks before it, and only chunks without one are replayed in order.
+	Indent_Kind_t style = UNSET;
+	for (size_t i = 0; i < chunks.size() && style == UNSET; i++) {
+		for (size_t m = 0; m < chunks[i].marks.size() && style == UNSET; m++) {
+			style = chunks[i].skipped ? UNSET : chunks[i].marks[m].kind;
+		}
+	}
+	auto ignore = [](TokenType_t, size_t) {};
+
+	for_each_chunk(chunks, [style, &ignore](Chunk_t& c) {
+		if (c.skipped) {
+			return;
+		}
+		c.fatal = std::any_of(c.marks.begin(), c.marks.end(), [style](const Indent_Mark_t& m) {
+			return m.kind != UNSET && m.kind != style;
+		});
+		auto reset = std::find_if(c.marks.rbegin(), c.marks.rend(),
+		                          [](const Indent_Mark_t& m) { return m.kind == UNSET; });
+		c.resets = reset != c.marks.rend();
+		if (c.resets) {
+			nip::error::Error_Handler ignored;
+			c.exit = Indentation_t(style);
+			for (auto m = reset.base() - 1; m != c.marks.end(); ++m) {
+				c.exit.apply(*m, ignored, ignore);
+			}
+		}
+	});
+
+	Indentation_t indentation;
+	bool fatal = false;
+	for (Chunk_t& c : chunks) {
+		if (c.skipped || fatal) {
+			c.skipped = true;
+			continue;
+		}
+		c.entry = indentation;
+		fatal   = c.fatal;
+		if (c.resets) {
+			indentation = c.exit;
+		}
+		else {
+			nip::error::Error_Handler ignored;
+			for (const Indent_Mark_t& m : c.marks) {
+				indentation.apply(m, ignored, ignore);
+			}
+		}
+	}
+
+	for_each_chunk(chunks, [](Chunk_t& c) {
+		if (c.skipped) {
+			return;
+		}
+		c.keep = c.tokens.size();
+		for (const Indent_Mark_t& m : c.marks) {
+			auto emit = [&c, &m](TokenType_t t, size_t off) {
+				c.indents.emplace_back(m.token, nip::Token_t(t, off));
+			};
+			size_t errors = c.indent_errors.size();
+			bool ok       = c.entry.apply(m, c.indent_errors, emit);
+			if (c.indent_errors.size() != errors) {
+				c.indent_error_at.push_back(m.error);
+			}
+			if (!ok) {
+				c.keep = m.token;
+				break;
+			}
+		}
+	});
+
+	size_t symbol_total = 0;
+	for (Chunk_t& c : chunks) {
+		symbol_total += c.caches.identifier.size();
+	}
+	tc.identifier.reserve(symbol_total);
+
+	size_t out_size = 0;
+	for (Chunk_t& c : chunks) {
+		if (c.skipped) {
+			continue;
+		}
+
+		// Errors are few, so they are merged in order right here
+		auto copy_errors = [&c, &errhdlr](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				const nip::error::_Error& e = c.errors.errors()[i];
+				errhdlr.add_error(e.type, e.msg.data(), e.offset, e.has_location);
+			}
+		};
+		size_t error = 0;
+		for (size_t i = 0; i < c.indent_error_at.size(); i++) {
+			copy_errors(error, c.indent_error_at[i]);
+			error                       = c.indent_error_at[i];
+			const nip::error::_Error& e = c.indent_errors.errors()[i];
+			errhdlr.add_error(e.type, e.msg.data(), e.offset, e.has_location);
+		}
+		if (!c.fatal) {
+			copy_errors(error, c.errors.size());
+		}
+
+		// Cache entries are handed out in token order, so the ones used before a fatal error are
+		// a prefix of each cache
+		size_t symbol_count  = c.caches.identifier.size();
+		size_t int_count     = c.caches.integer.size();
+		size_t float_count   = c.caches.floating_pt.size();
+		size_t string_count  = c.caches.string.size();
+		size_t decimal_count = c.caches.decimal.size();
+		if (c.fatal) {
+			symbol_count = int_count = float_count = string_count = decimal_count = 0;
+			for (auto t = c.tokens.begin(); t.position() < c.keep; ++t) {
+				size_t used = (*t).address + 1;
+				switch (t.type()) {
+					case IDENTIFIER:
+						symbol_count = std::max(symbol_count, used);
+						break;
+					case LIT_INT:
+						int_count = std::max(int_count, used);
+						break;
+					case LIT_FLOAT:
+						float_count = std::max(float_count, used);
+						break;
+					case LIT_STRING:
+						string_count++;
+						break;
+					case LIT_DECIMAL:
+						decimal_count++;
+						break;
+					default:
+						break;
+				}
+			}
+		}
+		c.symbols.resize(symbol_count);
+		for (nip::Symbol_t id = 0; id < symbol_count; id++) {
+			c.symbols[id] = tc.identifier.intern(c.caches.identifier, id);
+		}
+		c.integers.resize(int_count);
+		for (nip::Constant_t id = 0; id < int_count; id++) {
+			c.integers[id] = tc.integer.intern(c.caches.integer[id]);
+		}
+		c.floats.resize(float_count);
+		for (nip::Constant_t id = 0; id < float_count; id++) {
+			c.floats[id] = tc.floating_pt.intern(c.caches.floating_pt[id]);
+		}
+		c.string_base  = tc.string.append(c.caches.string, string_count);
+		c.decimal_base = tc.decimal.size();
+		tc.decimal.insert(tc.decimal.end(), c.caches.decimal.begin(),
+		                  c.caches.decimal.begin() + decimal_count);
+
+		c.out_first = out_size;
+		out_size += c.keep + c.indents.size();
+	}
+
+	nip::Token_Stream out;
+	out.resize(out_size);
+	for_each_chunk(chunks, [&out](Chunk_t& c) {
+		if (c.skipped) {
+			return;
+		}
+		size_t at  = c.out_first;
+		auto write = [&](TokenType_t t, size_t off, size_t add) {
+			out.set(at++, t, off, add);
+		};
+
+		auto indent = c.indents.begin();
+		auto token  = c.tokens.begin();
+		while (true) {
+			for (; indent != c.indents.end() && indent->first <= token.position(); ++indent) {
+				write(indent->second.type, indent->second.offset, 0);
+			}
+			if (token.position() == c.keep) {
+				break;
+			}
+
+			nip::Token_t t = *token;
+			switch (t.type) {
+				case IDENTIFIER:
+					t.address = c.symbols[t.address];
+					break;
+				case LIT_STRING:
+					t.address += c.string_base;
+					break;
+				case LIT_DECIMAL:
+					t.address += c.decimal_base;
+					break;
+				case LIT_INT:
+					t.address = c.integers[t.address];
+					break;
+				case LIT_FLOAT:
+					t.address = c.floats[t.address];
+					break;
+				default:
+					break;
+			}
+			write(t.type, t.offset, t.address);
+			++token;
+		}
+	});
+
+	// The last line doesn't need a trailing newline to be terminated
+	if (!fatal && out.size() && out.back_type() != NEWLINE) {
+		out.emplace_back(NEWLINE, source.size());
+	}
+	return out;
+}
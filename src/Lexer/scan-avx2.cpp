@@ -0,0 +1,189 @@
+#include "scan.hpp"
+#include "utf8.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+// Terminals are classified with a nibble lookup: each byte's low and high nibbles index two
+// 16 entry tables through vpshufb, and the byte is a terminal if the two results share a bit.
+// Every bit stands for one high nibble row of the ascii table that holds terminals:
+//
+//   bit 0: 0x0_  \t \n           bit 3: 0x5_  [ ]
+//   bit 1: 0x2_  space ( ) , .   bit 4: 0x7_  { }
+//   bit 2: 0x3_  : ;             bit 5: 0x3_  < >  (dropped in about mode)
+
+const char* nip::scan::identifier_end_avx2(const char* p, const char* end, bool about) {
+	const __m256i low_table = _mm256_setr_epi8(
+	    0x02, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x03, 0x05, 0x1C, 0x22, 0x18, 0x22, 0, //
+	    0x02, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x03, 0x05, 0x1C, 0x22, 0x18, 0x22, 0);
+	const __m256i high_table = _mm256_setr_epi8(
+	    0x01, 0, 0x02, 0x24, 0, 0x08, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0, //
+	    0x01, 0, 0x02, 0x24, 0, 0x08, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble     = _mm256_set1_epi8(0x0F);
+	const __m256i classes    = _mm256_set1_epi8(about ? 0x1F : 0x3F);
+	const __m256i zero       = _mm256_setzero_si256();
+	while (end - p >= 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i low   = _mm256_shuffle_epi8(low_table, _mm256_and_si256(block, nibble));
+		__m256i high  = _mm256_shuffle_epi8(
+		    high_table, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+		__m256i hits = _mm256_and_si256(_mm256_and_si256(low, high), classes);
+		uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hits, zero)));
+		mask |= static_cast<uint32_t>(_mm256_movemask_epi8(block));
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 32;
+	}
+	return identifier_end_scalar(p, end, about);
+}
+
+const char* nip::scan::run_end_avx2(const char* p, const char* end, char c) {
+	const __m256i needle = _mm256_set1_epi8(c);
+	while (end - p >= 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 32;
+	}
+	return run_end_scalar(p, end, c);
+}
+
+const char* nip::scan::find_either_avx2(const char* p, const char* end, char a, char b) {
+	const __m256i needle_a = _mm256_set1_epi8(a);
+	const __m256i needle_b = _mm256_set1_epi8(b);
+	while (end - p >= 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+		    _mm256_cmpeq_epi8(block, needle_a), _mm256_cmpeq_epi8(block, needle_b))));
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 32;
+	}
+	return find_either_scalar(p, end, a, b);
+}
+
+// UTF-8 is validated with the lookup algorithm of Keiser and Lemire ("Validating UTF-8 In Less
+// Than One Instruction Per Byte"). Every error a byte can be part of is a bit, and three nibble
+// lookups, on the high and low nibble of the byte before and the high nibble of the byte itself,
+// each give the errors that nibble allows. A pair is bad if all three agree on a bit:
+namespace {
+	constexpr uint8_t too_short      = 1 << 0; // Lead followed by a lead or ASCII
+	constexpr uint8_t too_long       = 1 << 1; // ASCII followed by a continuation
+	constexpr uint8_t overlong_3     = 1 << 2; // E0 80..9F
+	constexpr uint8_t too_large      = 1 << 3; // F4 90..BF, F5..FF
+	constexpr uint8_t surrogate      = 1 << 4; // ED A0..BF
+	constexpr uint8_t overlong_2     = 1 << 5; // C0, C1
+	constexpr uint8_t too_large_1000 = 1 << 6; // F5..FF 80..8F
+	constexpr uint8_t overlong_4     = 1 << 6; // F0 80..8F
+	constexpr uint8_t two_conts      = 1 << 7; // Continuation after a continuation
+	constexpr uint8_t carry          = too_short | too_long | two_conts;
+
+	// Bytes n places before each byte of block, taking the ones before it from prev
+	template <int n>
+	ALWAYS_INLINE __m256i before(__m256i block, __m256i prev) {
+		return _mm256_alignr_epi8(block, _mm256_permute2x128_si256(prev, block, 0x21), 16 - n);
+	}
+
+	ALWAYS_INLINE __m256i table(uint8_t e0, uint8_t e1, uint8_t e2, uint8_t e3, uint8_t e4,
+	                            uint8_t e5, uint8_t e6, uint8_t e7, uint8_t e8, uint8_t e9,
+	                            uint8_t e10, uint8_t e11, uint8_t e12, uint8_t e13, uint8_t e14,
+	                            uint8_t e15) {
+		return _mm256_setr_epi8(e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12, e13, e14,
+		                        e15, e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12, e13,
+		                        e14, e15);
+	}
+}
+
+const char* nip::scan::utf8_invalid_avx2(const char* p, const char* end) {
+	const __m256i byte_1_high = table(
+	    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long, two_conts,
+	    two_conts, two_conts, two_conts, too_short | overlong_2, too_short,
+	    too_short | overlong_3 | surrogate, too_short | too_large | too_large_1000 | overlong_4);
+	const __m256i byte_1_low = table(
+	    carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry,
+	    carry | too_large, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+	    carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+	    carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+	    carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+	    carry | too_large | too_large_1000 | surrogate, carry | too_large | too_large_1000,
+	    carry | too_large | too_large_1000);
+	const __m256i byte_2_high = table(
+	    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+	    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+	    too_long | overlong_2 | two_conts | overlong_3 | too_large,
+	    too_long | overlong_2 | two_conts | surrogate | too_large,
+	    too_long | overlong_2 | two_conts | surrogate | too_large, too_short, too_short, too_short,
+	    too_short);
+	// A lead this close to the end of a block needs bytes from the next one
+	const __m256i last_complete = _mm256_setr_epi8(
+	    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, //
+	    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, char(0xEF), char(0xDF), char(0xBF));
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+	const char* first       = p;
+	__m256i prev            = _mm256_setzero_si256();
+	__m256i prev_incomplete = _mm256_setzero_si256();
+	while (end - p >= 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		if (_mm256_movemask_epi8(block) == 0) {
+			if (!_mm256_testz_si256(prev_incomplete, prev_incomplete)) {
+				break;
+			}
+		}
+		else {
+			__m256i prev1  = before<1>(block, prev);
+			__m256i high_1 = _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble);
+			__m256i low_1  = _mm256_and_si256(prev1, nibble);
+			__m256i high_2 = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+			__m256i special =
+			    _mm256_and_si256(_mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, high_1),
+			                                      _mm256_shuffle_epi8(byte_1_low, low_1)),
+			                     _mm256_shuffle_epi8(byte_2_high, high_2));
+			// Third and fourth bytes are continuations after continuations, which is only fine
+			// two or three bytes after a three or four byte lead
+			__m256i third  = _mm256_subs_epu8(before<2>(block, prev), _mm256_set1_epi8(0x60));
+			__m256i fourth = _mm256_subs_epu8(before<3>(block, prev), _mm256_set1_epi8(0x70));
+			__m256i must_be_continued = _mm256_and_si256(_mm256_or_si256(third, fourth),
+			                                             _mm256_set1_epi8(char(0x80)));
+			__m256i error = _mm256_xor_si256(must_be_continued, special);
+			if (!_mm256_testz_si256(error, error)) {
+				break;
+			}
+		}
+		prev_incomplete = _mm256_subs_epu8(block, last_complete);
+		prev            = block;
+		p += 32;
+	}
+
+	// The rest, or the block with the error, goes through the scalar kernel to find the exact
+	// byte. A character cut off by the block boundary starts at most three bytes back.
+	for (int back = 1; back <= 3 && back <= p - first; back++) {
+		if (!nip::utf8::is_continuation(p[-back])) {
+			p -= back;
+			break;
+		}
+	}
+	return utf8_invalid_scalar(p, end);
+}
+
+void nip::scan::line_starts_avx2(const char* p, const char* end, uint32_t base,
+                                 std::vector<uint32_t>& out) {
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const char* q         = p;
+	for (; end - q >= 32; q += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q));
+		__m256i found = _mm256_cmpeq_epi8(block, newline);
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(found));
+		uint32_t at   = static_cast<uint32_t>(base + (q - p) + 1);
+		for (; mask; mask &= mask - 1) {
+			out.push_back(at + __builtin_ctz(mask));
+		}
+	}
+	line_starts_scalar(q, end, static_cast<uint32_t>(base + (q - p)), out);
+}
+
+#endif
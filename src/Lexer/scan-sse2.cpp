@@ -0,0 +1,95 @@
+#include "scan.hpp"
+#include "utf8.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+// SSE2 has no byte shuffle, so terminals are found with one compare per character in the set.
+// That is still 16 bytes for roughly as many instructions as the scalar loop spends on one.
+
+namespace {
+	constexpr char terminals[] = " \t\n{}[](),.:;";
+}
+
+const char* nip::scan::identifier_end_sse2(const char* p, const char* end, bool about) {
+	const __m128i angle_mask = _mm_set1_epi8(about ? 0 : -1);
+	while (end - p >= 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i hits  = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('<')),
+                                    _mm_cmpeq_epi8(block, _mm_set1_epi8('>')));
+		hits          = _mm_and_si128(hits, angle_mask);
+		for (size_t i = 0; i < sizeof(terminals) - 1; i++) {
+			hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(terminals[i])));
+		}
+		int mask = _mm_movemask_epi8(hits) | _mm_movemask_epi8(block);
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+	return identifier_end_scalar(p, end, about);
+}
+
+const char* nip::scan::run_end_sse2(const char* p, const char* end, char c) {
+	__m128i needle = _mm_set1_epi8(c);
+	while (end - p >= 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		int mask      = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)) ^ 0xFFFF;
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+	return run_end_scalar(p, end, c);
+}
+
+const char* nip::scan::find_either_sse2(const char* p, const char* end, char a, char b) {
+	__m128i needle_a = _mm_set1_epi8(a);
+	__m128i needle_b = _mm_set1_epi8(b);
+	while (end - p >= 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		int mask      = _mm_movemask_epi8(
+		    _mm_or_si128(_mm_cmpeq_epi8(block, needle_a), _mm_cmpeq_epi8(block, needle_b)));
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+	return find_either_scalar(p, end, a, b);
+}
+
+// Without a byte shuffle the lookup validation of the AVX2 kernel doesn't pay off, so only runs
+// of ASCII are vectorized and every other character is checked on its own
+const char* nip::scan::utf8_invalid_sse2(const char* p, const char* end) {
+	while (end - p >= 16) {
+		int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+		if (mask == 0) {
+			p += 16;
+			continue;
+		}
+		p += __builtin_ctz(mask);
+		size_t length = nip::utf8::valid_length(p, end);
+		if (length == 0) {
+			return p;
+		}
+		p += length;
+	}
+	return utf8_invalid_scalar(p, end);
+}
+
+void nip::scan::line_starts_sse2(const char* p, const char* end, uint32_t base,
+                                 std::vector<uint32_t>& out) {
+	__m128i newline = _mm_set1_epi8('\n');
+	const char* q   = p;
+	for (; end - q >= 16; q += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q));
+		int mask      = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+		uint32_t at   = static_cast<uint32_t>(base + (q - p) + 1);
+		for (; mask; mask &= mask - 1) {
+			out.push_back(at + __builtin_ctz(mask));
+		}
+	}
+	line_starts_scalar(q, end, static_cast<uint32_t>(base + (q - p)), out);
+}
+
+#endif
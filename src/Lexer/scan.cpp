@@ -0,0 +1,80 @@
+#include "scan.hpp"
+#include "utf8.hpp"
+
+#include <cstring>
+
+namespace {
+	nip::scan::Kernels_t select_kernels() {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return {nip::scan::identifier_end_avx2, nip::scan::run_end_avx2,
+			        nip::scan::find_either_avx2, nip::scan::utf8_invalid_avx2,
+			        nip::scan::line_starts_avx2, "avx2"};
+		}
+		if (__builtin_cpu_supports("sse2")) {
+			return {nip::scan::identifier_end_sse2, nip::scan::run_end_sse2,
+			        nip::scan::find_either_sse2, nip::scan::utf8_invalid_sse2,
+			        nip::scan::line_starts_sse2, "sse2"};
+		}
+#endif
+		return {nip::scan::identifier_end_scalar, nip::scan::run_end_scalar,
+		        nip::scan::find_either_scalar, nip::scan::utf8_invalid_scalar,
+		        nip::scan::line_starts_scalar, "scalar"};
+	}
+}
+
+const nip::scan::Kernels_t& nip::scan::kernels() {
+	static const Kernels_t selected = select_kernels();
+	return selected;
+}
+
+const char* nip::scan::identifier_end_scalar(const char* p, const char* end, bool about) {
+	while (p != end && !is_identifier_end(*p, about)) {
+		p++;
+	}
+	return p;
+}
+
+const char* nip::scan::run_end_scalar(const char* p, const char* end, char c) {
+	while (p != end && *p == c) {
+		p++;
+	}
+	return p;
+}
+
+const char* nip::scan::find_either_scalar(const char* p, const char* end, char a, char b) {
+	while (p != end && *p != a && *p != b) {
+		p++;
+	}
+	return p;
+}
+
+// Eight ASCII bytes at a time, and one character at a time otherwise
+const char* nip::scan::utf8_invalid_scalar(const char* p, const char* end) {
+	while (p != end) {
+		if (end - p >= 8) {
+			uint64_t word;
+			std::memcpy(&word, p, 8);
+			if ((word & 0x8080808080808080ull) == 0) {
+				p += 8;
+				continue;
+			}
+		}
+		size_t length = nip::utf8::valid_length(p, end);
+		if (length == 0) {
+			return p;
+		}
+		p += length;
+	}
+	return p;
+}
+
+void nip::scan::line_starts_scalar(const char* p, const char* end, uint32_t base,
+                                   std::vector<uint32_t>& out) {
+	for (const char* q = p; q != end; q++) {
+		if (*q == '\n') {
+			out.push_back(static_cast<uint32_t>(base + (q - p) + 1));
+		}
+	}
+}
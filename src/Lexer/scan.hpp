@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Character class scanning kernels for the lexer. Every kernel takes a half open byte range and
+// returns a pointer to the first byte that stops the scan, or end if nothing does. Each kernel
+// has a scalar version and vectorized versions compiled in their own -sse2/-avx2 translation
+// units; the fastest one the cpu supports is picked once, the first time kernels() is called.
+namespace nip {
+	namespace scan {
+		// Character classes, one bit each, for the scalar lookup table
+		enum Char_Class_t : uint8_t {
+			TERMINAL       = 1 << 0, // Ends an identifier everywhere: whitespace and punctuation
+			ANGLE_TERMINAL = 1 << 1, // < and >, which only end an identifier outside about mode
+			NON_ASCII      = 1 << 2, // Any byte of a multibyte character, see identifier_end
+		};
+
+		struct Char_Class_Table_t {
+			uint8_t entries[256] = {};
+			constexpr Char_Class_Table_t() {
+				const char* terminals = " \t\n{}[](),.:;";
+				for (size_t i = 0; terminals[i] != '\0'; i++) {
+					entries[static_cast<unsigned char>(terminals[i])] |= TERMINAL;
+				}
+				entries[static_cast<unsigned char>('<')] |= ANGLE_TERMINAL;
+				entries[static_cast<unsigned char>('>')] |= ANGLE_TERMINAL;
+				for (size_t c = 0x80; c < 0x100; c++) {
+					entries[c] |= NON_ASCII;
+				}
+			}
+			constexpr uint8_t operator[](char c) const {
+				return entries[static_cast<unsigned char>(c)];
+			}
+		};
+
+		inline constexpr Char_Class_Table_t char_class;
+
+		ALWAYS_INLINE bool is_identifier_end(char c, bool about) {
+			uint8_t mask = about ? (TERMINAL | NON_ASCII) : (TERMINAL | ANGLE_TERMINAL | NON_ASCII);
+			return char_class[c] & mask;
+		}
+
+		struct Kernels_t {
+			// First byte that terminates an identifier, or starts a non-ASCII character, which the
+			// lexer looks at itself. In about mode < and > are part of the name.
+			const char* (*identifier_end)(const char* p, const char* end, bool about);
+			// First byte that isn't c, for indentation and whitespace runs.
+			const char* (*run_end)(const char* p, const char* end, char c);
+			// First byte that is either a or b, for skipping comments.
+			const char* (*find_either)(const char* p, const char* end, char a, char b);
+			// First byte of a malformed UTF-8 sequence. p must start a character.
+			const char* (*utf8_invalid)(const char* p, const char* end);
+			// Appends where every line starting in the range begins, counting p as offset base.
+			void (*line_starts)(const char* p, const char* end, uint32_t base,
+			                    std::vector<uint32_t>& out);
+			const char* name;
+		};
+
+		const Kernels_t& kernels();
+
+		// Implementations, only to be called through kernels()
+		const char* identifier_end_scalar(const char* p, const char* end, bool about);
+		const char* run_end_scalar(const char* p, const char* end, char c);
+		const char* find_either_scalar(const char* p, const char* end, char a, char b);
+		const char* utf8_invalid_scalar(const char* p, const char* end);
+		void line_starts_scalar(const char* p, const char* end, uint32_t base,
+		                        std::vector<uint32_t>& out);
+
+#if defined(__x86_64__) || defined(__i386__)
+		const char* identifier_end_sse2(const char* p, const char* end, bool about);
+		const char* run_end_sse2(const char* p, const char* end, char c);
+		const char* find_either_sse2(const char* p, const char* end, char a, char b);
+		const char* utf8_invalid_sse2(const char* p, const char* end);
+		void line_starts_sse2(const char* p, const char* end, uint32_t base,
+		                      std::vector<uint32_t>& out);
+
+		const char* identifier_end_avx2(const char* p, const char* end, bool about);
+		const char* run_end_avx2(const char* p, const char* end, char c);
+		const char* find_either_avx2(const char* p, const char* end, char a, char b);
+		const char* utf8_invalid_avx2(const char* p, const char* end);
+		void line_starts_avx2(const char* p, const char* end, uint32_t base,
+		                      std::vector<uint32_t>& out);
+#endif
+	}
+}
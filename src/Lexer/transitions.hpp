@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../token.hpp"
+#include "scan.hpp"
+#include "utf8.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// The lexer's dispatch table. What a byte starts depends only on the lexer's state and the byte
+// itself, so every pair is worked out at compile time: step() reads one entry and jumps straight
+// to the code for that kind of token. Tokens longer than a byte (comments, strings, numbers and
+// identifiers) are consumed whole by the action they start, so no byte is looked at twice.
+namespace nip {
+	namespace lex {
+		enum Lex_State_t : uint8_t {
+			LINE_START, // Nothing but indentation read on this line yet
+			CODE,
+			ABOUT, // Right after the about keyword, where only names are lexed
+			STATE_COUNT
+		};
+
+		enum Action_t : uint8_t {
+			SKIP,          // Not part of any token
+			END_LINE,      // \n
+			INDENT_TABS,   // Tab indentation, or the start of a line with nothing on it
+			INDENT_SPACES, // Space indentation, or the start of a line with nothing on it
+			SPACES,        // Whitespace between tokens
+			SYMBOL,        // A one byte token, given by Transition_t::token
+			SLASH,         // A comment or an identifier
+			DASH,          // ->, a negative number or an identifier
+			COLONS,        // : or ::
+			DOTS,          // . or ...
+			ANGLE,         // < or the identifier <>
+			CHARACTER,     // Character literal
+			STRING,        // String literal, single or triple quoted
+			NUMBER,        // Numeric literal
+			WORD,          // Identifier or keyword
+			ABOUT_WORD,    // Identifier in about mode, where < and > are part of the name
+			WIDE_SPACE     // Unicode whitespace, otherwise an identifier
+		};
+
+		struct Transition_t {
+			Action_t action = SKIP;
+			uint8_t token   = NUL; // TokenType_t of a SYMBOL
+			// Set in LINE_START for bytes that start code, meaning the line has no indentation.
+			// Not set for / and WIDE_SPACE, which might leave the line blank, so their actions see
+			// to the indentation themselves.
+			bool column_one = false;
+		};
+
+		struct Transition_Table_t {
+			Transition_t entries[STATE_COUNT][256] = {};
+
+			constexpr Transition_Table_t() {
+				for (size_t c = 0; c < 256; c++) {
+					bool letter = !(nip::scan::char_class[static_cast<char>(c)] &
+					                nip::scan::TERMINAL);
+					entries[CODE][c].action = letter ? WORD : SKIP;
+					entries[ABOUT][c].action = letter ? ABOUT_WORD : SKIP;
+				}
+				const char* digits = "0123456789";
+				for (size_t i = 0; digits[i] != '\0'; i++) {
+					set(CODE, digits[i], NUMBER);
+				}
+				set(CODE, '{', SYMBOL, LEFT_BRACKET);
+				set(CODE, '}', SYMBOL, RIGHT_BRACKET);
+				set(CODE, '[', SYMBOL, LEFT_SQUARE);
+				set(CODE, ']', SYMBOL, RIGHT_SQUARE);
+				set(CODE, '(', SYMBOL, LEFT_PAREN);
+				set(CODE, ')', SYMBOL, RIGHT_PAREN);
+				set(CODE, ',', SYMBOL, COMMA);
+				set(CODE, '>', SYMBOL, RIGHT_CARROT);
+				set(CODE, '+', SYMBOL, PLUS);
+				set(CODE, ';', SYMBOL, SEMI_COLON);
+				set(CODE, '/', SLASH);
+				set(CODE, '-', DASH);
+				set(CODE, ':', COLONS);
+				set(CODE, '.', DOTS);
+				set(CODE, '<', ANGLE);
+				set(CODE, '\'', CHARACTER);
+				set(CODE, '"', STRING);
+				for (unsigned char lead : nip::utf8::space_leads) {
+					set(CODE, lead, WIDE_SPACE);
+					set(ABOUT, lead, WIDE_SPACE);
+				}
+
+				for (size_t c = 0; c < 256; c++) {
+					entries[LINE_START][c]            = entries[CODE][c];
+					entries[LINE_START][c].column_one = true;
+				}
+				for (size_t s = 0; s < STATE_COUNT; s++) {
+					set(static_cast<Lex_State_t>(s), '\n', END_LINE);
+					set(static_cast<Lex_State_t>(s), ' ', SPACES);
+					set(static_cast<Lex_State_t>(s), '\t', SKIP);
+				}
+				set(LINE_START, '\t', INDENT_TABS);
+				set(LINE_START, ' ', INDENT_SPACES);
+				set(LINE_START, '/', SLASH);
+				for (unsigned char lead : nip::utf8::space_leads) {
+					set(LINE_START, lead, WIDE_SPACE);
+				}
+			}
+
+			constexpr void set(Lex_State_t s, char c, Action_t a, TokenType_t t = NUL) {
+				entries[s][static_cast<unsigned char>(c)] = {a, static_cast<uint8_t>(t), false};
+			}
+
+			constexpr const Transition_t& operator()(Lex_State_t s, char c) const {
+				return entries[s][static_cast<unsigned char>(c)];
+			}
+		};
+
+		inline constexpr Transition_Table_t transitions;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Scalar UTF-8 helpers. Sources are UTF-8, but the lexer only ever needs to look at a character
+// as a whole when it isn't ASCII, so these are kept off the fast paths.
+namespace nip {
+	namespace utf8 {
+		ALWAYS_INLINE bool is_ascii(char c) {
+			return static_cast<unsigned char>(c) < 0x80;
+		}
+		ALWAYS_INLINE bool is_continuation(char c) {
+			return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+		}
+
+		// Length of the well formed character at p, or 0 if the bytes there aren't one
+		ALWAYS_INLINE size_t valid_length(const char* p, const char* end) {
+			unsigned char c = static_cast<unsigned char>(*p);
+			if (c < 0x80) {
+				return 1;
+			}
+			// The second byte's range is narrower after a few leads, to rule out overlong forms,
+			// surrogates and code points past U+10FFFF
+			size_t length     = 0;
+			unsigned char low = 0x80, high = 0xBF;
+			if (c >= 0xC2 && c <= 0xDF) {
+				length = 2;
+			}
+			else if (c >= 0xE0 && c <= 0xEF) {
+				length = 3;
+				low    = c == 0xE0 ? 0xA0 : 0x80;
+				high   = c == 0xED ? 0x9F : 0xBF;
+			}
+			else if (c >= 0xF0 && c <= 0xF4) {
+				length = 4;
+				low    = c == 0xF0 ? 0x90 : 0x80;
+				high   = c == 0xF4 ? 0x8F : 0xBF;
+			}
+			if (length == 0 || size_t(end - p) < length) {
+				return 0;
+			}
+			unsigned char second = static_cast<unsigned char>(p[1]);
+			if (second < low || second > high) {
+				return 0;
+			}
+			for (size_t i = 2; i < length; i++) {
+				if (!is_continuation(p[i])) {
+					return 0;
+				}
+			}
+			return length;
+		}
+
+		// Bytes to step over for the character at p: its whole length when well formed, and one
+		// otherwise, so malformed input is taken a byte at a time
+		ALWAYS_INLINE size_t step_length(const char* p, const char* end) {
+			size_t length = valid_length(p, end);
+			return length ? length : 1;
+		}
+
+		// Length of the Unicode whitespace character at p, or 0 if there isn't one. ASCII
+		// whitespace is left to the lexer's tables. A byte order mark counts as whitespace too.
+		inline size_t space_length(const char* p, const char* end) {
+			auto at = [p, end](size_t i) {
+				return size_t(end - p) > i ? static_cast<unsigned char>(p[i]) : 0;
+			};
+			switch (at(0)) {
+				case 0xC2: // U+0085, U+00A0
+					return at(1) == 0x85 || at(1) == 0xA0 ? 2 : 0;
+				case 0xE1: // U+1680
+					return at(1) == 0x9A && at(2) == 0x80 ? 3 : 0;
+				case 0xE2: // U+2000-U+200A, U+2028, U+2029, U+202F, U+205F
+					if (at(1) == 0x80) {
+						unsigned char c = at(2);
+						bool space = c <= 0x8A || c == 0xA8 || c == 0xA9 || c == 0xAF;
+						return c >= 0x80 && space ? 3 : 0;
+					}
+					return at(1) == 0x81 && at(2) == 0x9F ? 3 : 0;
+				case 0xE3: // U+3000
+					return at(1) == 0x80 && at(2) == 0x80 ? 3 : 0;
+				case 0xEF: // U+FEFF
+					return at(1) == 0xBB && at(2) == 0xBF ? 3 : 0;
+			}
+			return 0;
+		}
+
+		// Lead bytes of every character space_length() accepts
+		constexpr unsigned char space_leads[] = {0xC2, 0xE1, 0xE2, 0xE3, 0xEF};
+
+		// Characters in [p, end), which must start on a character boundary
+		inline size_t code_points(const char* p, const char* end) {
+			size_t count = 0;
+			for (; p != end; p++) {
+				count += !is_continuation(*p);
+			}
+			return count;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#include "declarationindex.hpp"
+
+void nip::parse::Declaration_Index::add(nip::TokenType_t keyword, size_t token, size_t depth,
+                                        bool synonym, const nip::Symbol_t* path,
+                                        size_t path_length, const nip::Symbol_t* own,
+                                        size_t own_length) {
+	size_t first = names.size();
+	names.insert(names.end(), path, path + path_length);
+	names.insert(names.end(), own, own + own_length);
+	declarations.push_back({static_cast<uint32_t>(token), static_cast<uint32_t>(first),
+	                        static_cast<uint16_t>(names.size() - first),
+	                        static_cast<uint16_t>(depth), static_cast<uint8_t>(keyword), synonym});
+}
+
+void nip::parse::Declaration_Index::build(const nip::Token_Stream& tokens) {
+	clear();
+	const uint8_t* types = tokens.type_data();
+	size_t count         = tokens.size();
+	auto type            = [&](size_t i) {
+		return i < count ? static_cast<nip::TokenType_t>(types[i]) : NUL;
+	};
+
+	// The path of the vocabulary being indexed is [base, paths.size()). Opening a vocabulary
+	// pushes its name, and one named from the root starts a new path after the old one. Its block
+	// is open until the depth drops below what it was just inside it.
+	struct Scope_t {
+		size_t outer_base;
+		size_t outer_end;
+		size_t depth;
+	};
+	std::vector<Scope_t> scopes;
+	std::vector<nip::Symbol_t> paths;
+	size_t base  = 0;
+	size_t depth = 0;
+	auto path    = [&] { return paths.data() + base; };
+	auto length  = [&] { return paths.size() - base; };
+
+	for (size_t i = 0; i < count; i++) {
+		switch (types[i]) {
+			case INDENT:
+			case LEFT_BRACKET:
+				depth++;
+				break;
+
+			case DEDENT:
+			case RIGHT_BRACKET:
+				depth -= depth > 0;
+				while (!scopes.empty() && scopes.back().depth > depth) {
+					paths.resize(scopes.back().outer_end);
+					base = scopes.back().outer_base;
+					scopes.pop_back();
+				}
+				break;
+
+			case KEY_VOCAB: {
+				bool synonym = type(i + 1) == KEY_SYNONYM;
+				bool rooted  = type(i + 1 + synonym) == DOUBLE_COLON;
+				size_t j     = i + 1 + synonym + rooted;
+				if (type(j) != IDENTIFIER) {
+					break;
+				}
+				if (synonym) {
+					add(KEY_VOCAB, i, depth, true, path(), length(), &tokens.payload_data()[j], 1);
+					break;
+				}
+
+				// A name like a::b is a vocabulary in a vocabulary
+				size_t outer_base = base;
+				size_t outer_end  = paths.size();
+				if (rooted) {
+					base = outer_end;
+				}
+				paths.push_back(tokens.payload(j));
+				while (type(j + 1) == DOUBLE_COLON && type(j + 2) == IDENTIFIER) {
+					j += 2;
+					paths.push_back(tokens.payload(j));
+				}
+				add(KEY_VOCAB, i, depth, false, path(), length(), nullptr, 0);
+
+				// Only a vocabulary with a block of its own is in scope past its head. The
+				// opener is counted here, since the loop carries on after it.
+				size_t opener = j + 1;
+				if (type(opener) == COLON) {
+					opener += 1 + (type(opener + 1) == NEWLINE);
+				}
+				if (type(opener) != INDENT && type(opener) != LEFT_BRACKET) {
+					paths.resize(outer_end);
+					base = outer_base;
+					break;
+				}
+				depth++;
+				scopes.push_back({outer_base, outer_end, depth});
+				i = opener;
+				break;
+			}
+
+			case KEY_ABOUT:
+			case KEY_DEFINE:
+			case KEY_TRAIT:
+			case KEY_INSTANCE:
+			case KEY_TYPE: {
+				bool synonym = types[i] == KEY_TYPE && type(i + 1) == KEY_SYNONYM;
+				size_t j     = i + 1 + synonym;
+				if (type(j) == IDENTIFIER) {
+					add(static_cast<nip::TokenType_t>(types[i]), i, depth, synonym, path(),
+					    length(), &tokens.payload_data()[j], 1);
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../symboltable.hpp"
+#include "../token.hpp"
+#include "../tokenstream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nip {
+	namespace parse {
+		// Where every vocab, about, define, trait, instance and type of a program starts, with
+		// its qualified name. It is built in one pass over the token types, so the passes that
+		// only care about some declarations can go straight to them instead of scanning the whole
+		// program each.
+		class Declaration_Index {
+		  public:
+			struct Declaration_t {
+				uint32_t token;       // Of the keyword
+				uint32_t name;        // Where its qualified name starts in the index's names
+				uint16_t name_length; // The vocabularies it is in, then its own name
+				uint16_t depth;       // Blocks it is nested in, 0 at the top level
+				uint8_t keyword;      // TokenType_t of the keyword
+				bool synonym;
+			};
+
+			struct Name_t {
+				const nip::Symbol_t* first;
+				const nip::Symbol_t* last;
+				const nip::Symbol_t* begin() const {
+					return first;
+				}
+				const nip::Symbol_t* end() const {
+					return last;
+				}
+				nip::Symbol_t back() const {
+					return last[-1];
+				}
+			};
+
+			// Indexes tokens, replacing whatever was indexed before. A declaration without a name
+			// is left out, to be reported by the parser.
+			void build(const nip::Token_Stream& tokens);
+			void clear() {
+				declarations.clear();
+				names.clear();
+			}
+
+			Name_t name(const Declaration_t& d) const {
+				const nip::Symbol_t* first = names.data() + d.name;
+				return {first, first + d.name_length};
+			}
+
+			size_t size() const {
+				return declarations.size();
+			}
+			const Declaration_t& operator[](size_t i) const {
+				return declarations[i];
+			}
+			auto begin() const {
+				return declarations.begin();
+			}
+			auto end() const {
+				return declarations.end();
+			}
+
+		  private:
+			void add(nip::TokenType_t keyword, size_t token, size_t depth, bool synonym,
+			         const nip::Symbol_t* path, size_t path_length, const nip::Symbol_t* own,
+			         size_t own_length);
+
+			std::vector<Declaration_t> declarations; // In source order
+			std::vector<nip::Symbol_t> names;        // Every qualified name, back to back
+		};
+	}
+}
@@ -0,0 +1,77 @@
+#include "functortable.hpp"
+#include "../util.hpp"
+
+#include <algorithm>
+
+uint64_t nip::parse::Functor_Table::hash(const std::vector<nip::Symbol_t>& path) {
+	return nip::util::hash_bytes(path.data(), path.size() * sizeof(nip::Symbol_t));
+}
+
+// Finds the slot holding path, or the empty slot it would go into
+size_t nip::parse::Functor_Table::probe(const std::vector<nip::Symbol_t>& path, uint64_t h) const {
+	size_t mask = slots.size() - 1;
+	for (size_t i = h & mask;; i = (i + 1) & mask) {
+		uint32_t id = slots[i];
+		if (id == no_entry) {
+			return i;
+		}
+		if (hashes[id] == h) {
+			Name_t name = this->name(entries[id]);
+			if (std::equal(name.begin(), name.end(), path.begin(), path.end())) {
+				return i;
+			}
+		}
+	}
+}
+
+void nip::parse::Functor_Table::rehash(size_t slot_count) {
+	slots.assign(slot_count, no_entry);
+	size_t mask = slots.size() - 1;
+	for (uint32_t id = 0; id < hashes.size(); id++) {
+		size_t i = hashes[id] & mask;
+		while (slots[i] != no_entry) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = id;
+	}
+}
+
+Functor_Pre_Info_t& nip::parse::Functor_Table::get(const std::vector<nip::Symbol_t>& path,
+                                                   bool& added) {
+	// Keep the load factor under a half
+	if ((entries.size() + 1) * 2 > slots.size()) {
+		rehash(slots.empty() ? 256 : slots.size() * 2);
+	}
+
+	uint64_t h  = hash(path);
+	size_t slot = probe(path, h);
+	added       = slots[slot] == no_entry;
+	if (!added) {
+		return entries[slots[slot]];
+	}
+
+	slots[slot] = static_cast<uint32_t>(entries.size());
+	hashes.push_back(h);
+	entries.emplace_back();
+	entries.back().name        = static_cast<uint32_t>(names.size());
+	entries.back().name_length = static_cast<uint16_t>(path.size());
+	names.insert(names.end(), path.begin(), path.end());
+	return entries.back();
+}
+
+Functor_Pre_Info_t* nip::parse::Functor_Table::find(const std::vector<nip::Symbol_t>& path) {
+	if (slots.empty()) {
+		return nullptr;
+	}
+	uint32_t id = slots[probe(path, hash(path))];
+	return id == no_entry ? nullptr : &entries[id];
+}
+
+void nip::parse::Functor_Table::clear() {
+	entries.clear();
+	hashes.clear();
+	slots.clear();
+	names.clear();
+	fields.clear();
+	about_values.clear();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../literaltable.hpp"
+#include "../symboltable.hpp"
+#include "../token.hpp"
+#include "../utilmacro.hpp"
+#include "declarationindex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// This structure holds information on functions so they can be properly called. Its name and
+// about fields are kept by the Functor_Table it is in, so it doesn't own any memory itself.
+struct Functor_Pre_Info_t {
+	static constexpr uint32_t no_field = ~uint32_t{0};
+
+	uint32_t name        = 0; // Where its qualified name starts in the table's names
+	uint16_t name_length = 0;
+	size_t trait_argument_count = 0;
+	std::pair<size_t, size_t> argument_count = std::make_pair(size_t{0}, size_t{0});
+	enum : uint8_t { INFIX_LEFT, INFIX_RIGHT, POSTFIX } calling_type = POSTFIX;
+	intmax_t presidence = 0;
+	bool declared       = false;
+	bool abouted        = false;
+	uint32_t first_field = no_field; // Its about fields, in the order they were read
+	uint32_t last_field  = no_field;
+	nip::Literal_t documentation = nip::Literal_Table::no_literal;
+};
+
+namespace nip {
+	namespace parse {
+		// The functors of a program, looked up by their qualified name: the path of vocabularies
+		// down to them, then their own name. Entries are kept in order of first appearance.
+		//
+		// Everything an entry has of variable size is stored flat, in arrays shared by all of
+		// them: names back to back, about fields in one array, and the fields' values in
+		// another. A value is a token's type and its address in the token caches, so numbers
+		// are kept as the numbers they are, and documentation is a string literal, which is a
+		// view of the source unless it had escapes.
+		class Functor_Table {
+		  public:
+			using Name_t = nip::parse::Declaration_Index::Name_t;
+
+			struct About_Value_t {
+				uint32_t address; // In the token cache for its type
+				uint8_t type;     // TokenType_t of an identifier or a number literal
+			};
+			struct About_Field_t {
+				nip::Symbol_t key;
+				uint32_t first_value;
+				uint32_t value_count;
+				uint32_t next; // The functor's field after this one, or no_field
+			};
+			struct Values_t {
+				const About_Value_t* first;
+				const About_Value_t* last;
+				const About_Value_t* begin() const {
+					return first;
+				}
+				const About_Value_t* end() const {
+					return last;
+				}
+			};
+
+			// The entry named by path, which is made empty if there wasn't one. added says which.
+			// The reference is good until the next entry is added.
+			Functor_Pre_Info_t& get(const std::vector<nip::Symbol_t>& path, bool& added);
+			// nullptr if there is no entry named by path
+			Functor_Pre_Info_t* find(const std::vector<nip::Symbol_t>& path);
+			void clear();
+
+			Name_t name(const Functor_Pre_Info_t& f) const {
+				const nip::Symbol_t* first = names.data() + f.name;
+				return {first, first + f.name_length};
+			}
+
+			// Starts an about field of f, which takes every value added until the next field is
+			// started
+			ALWAYS_INLINE void add_field(Functor_Pre_Info_t& f, nip::Symbol_t key);
+			ALWAYS_INLINE void add_value(nip::TokenType_t type, size_t address);
+
+			const About_Field_t& field(uint32_t id) const {
+				return fields[id];
+			}
+			Values_t values(const About_Field_t& field) const {
+				const About_Value_t* first = about_values.data() + field.first_value;
+				return {first, first + field.value_count};
+			}
+
+			size_t size() const {
+				return entries.size();
+			}
+			auto begin() const {
+				return entries.begin();
+			}
+			auto end() const {
+				return entries.end();
+			}
+
+		  private:
+			static constexpr uint32_t no_entry = ~uint32_t{0};
+
+			static uint64_t hash(const std::vector<nip::Symbol_t>& path);
+			size_t probe(const std::vector<nip::Symbol_t>& path, uint64_t h) const;
+			void rehash(size_t slot_count);
+
+			std::vector<Functor_Pre_Info_t> entries;
+			std::vector<uint64_t> hashes; // Of each entry's name
+			std::vector<uint32_t> slots;  // Open addressed, power of two sized, no_entry if empty
+
+			std::vector<nip::Symbol_t> names;  // Every entry's name, back to back
+			std::vector<About_Field_t> fields; // Every entry's about fields
+			std::vector<About_Value_t> about_values;
+		};
+	}
+}
+
+ALWAYS_INLINE void nip::parse::Functor_Table::add_field(Functor_Pre_Info_t& f, nip::Symbol_t key) {
+	uint32_t id = static_cast<uint32_t>(fields.size());
+	fields.push_back({key, static_cast<uint32_t>(about_values.size()), 0,
+	                  Functor_Pre_Info_t::no_field});
+	if (f.last_field == Functor_Pre_Info_t::no_field) {
+		f.first_field = id;
+	}
+	else {
+		fields[f.last_field].next = id;
+	}
+	f.last_field = id;
+}
+
+ALWAYS_INLINE void nip::parse::Functor_Table::add_value(nip::TokenType_t type, size_t address) {
+	about_values.push_back({static_cast<uint32_t>(address), static_cast<uint8_t>(type)});
+	fields.back().value_count++;
+}
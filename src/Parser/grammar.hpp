@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+// The parser's dispatch tables. Which element or term the parser is at depends only on the token
+// it starts with, so the FIRST set of every production is written down here once and turned into
+// a table at compile time: element() and term() read one entry and jump straight to the
+// production instead of trying each in turn. Sets of token types are masks, so asking whether a
+// token is any of several types is a single test too.
+namespace nip {
+	namespace parse {
+		// Token types, one bit each
+		struct Token_Set_t {
+			static_assert(KEY_WITH < 64, "every token type needs a bit");
+			uint64_t bits = 0;
+
+			constexpr Token_Set_t() = default;
+			constexpr Token_Set_t(std::initializer_list<TokenType_t> types) {
+				for (TokenType_t t : types) {
+					bits |= uint64_t{1} << t;
+				}
+			}
+
+			constexpr bool contains(TokenType_t t) const {
+				return bits >> t & 1;
+			}
+		};
+
+		enum Element_t : uint8_t {
+			NO_ELEMENT, // A line with nothing on it
+			STATEMENT_ELEMENT,
+			TRAIT_ELEMENT,
+			INTRINSIC_ELEMENT,
+			DEFINITION_ELEMENT,
+			INSTANCE_ELEMENT,
+			PERMISSION_ELEMENT,
+			ABOUT_ELEMENT,
+			TYPE_ELEMENT,  // Or a type synonym
+			VOCAB_ELEMENT, // Or a vocabulary synonym
+			IMPORT_ELEMENT,
+			EXPORT_ELEMENT
+		};
+
+		enum Term_t : uint8_t {
+			NO_TERM,
+			LEAF_TERM, // Nothing but its token
+			NAME_TERM,
+			GROUP_TERM,
+			VECTOR_TERM,
+			BLOCK_TERM,
+			LAMBDA_TERM,
+			IF_TERM,
+			MATCH_TERM,
+			DO_TERM,
+			WITH_TERM
+		};
+
+		// A production and the token types it can start with
+		template <class Production_t>
+		struct Rule_t {
+			Production_t production;
+			Token_Set_t first;
+		};
+
+		// The production every token type starts, made from the rules of a grammar, and
+		// otherwise for a type none of them start. The FIRST sets have to be disjoint, or a
+		// token wouldn't say which production it is, which ambiguous records.
+		template <class Production_t>
+		struct First_Table_t {
+			Production_t entries[KEY_WITH + 1] = {};
+			Token_Set_t first;      // Every type some rule starts
+			bool ambiguous = false; // Some type is in two rules' sets
+
+			constexpr First_Table_t(Production_t otherwise,
+			                        std::initializer_list<Rule_t<Production_t>> rules) {
+				for (Production_t& e : entries) {
+					e = otherwise;
+				}
+				for (const Rule_t<Production_t>& r : rules) {
+					ambiguous |= (first.bits & r.first.bits) != 0;
+					first.bits |= r.first.bits;
+					for (size_t t = 0; t <= KEY_WITH; t++) {
+						if (r.first.contains(static_cast<TokenType_t>(t))) {
+							entries[t] = r.production;
+						}
+					}
+				}
+			}
+
+			constexpr Production_t operator[](TokenType_t t) const {
+				return entries[t];
+			}
+		};
+
+		// Anything that isn't a keyword starting some other element is a statement
+		inline constexpr First_Table_t<Element_t> element_first = {
+		    STATEMENT_ELEMENT,
+		    {{NO_ELEMENT, {NEWLINE, SEMI_COLON}},
+		     {TRAIT_ELEMENT, {KEY_TRAIT}},
+		     {INTRINSIC_ELEMENT, {KEY_INTRIN}},
+		     {DEFINITION_ELEMENT, {KEY_DEFINE}},
+		     {INSTANCE_ELEMENT, {KEY_INSTANCE}},
+		     {PERMISSION_ELEMENT, {KEY_PERMIT}},
+		     {ABOUT_ELEMENT, {KEY_ABOUT}},
+		     {TYPE_ELEMENT, {KEY_TYPE}},
+		     {VOCAB_ELEMENT, {KEY_VOCAB}},
+		     {IMPORT_ELEMENT, {KEY_IMPORT}},
+		     {EXPORT_ELEMENT, {KEY_EXPORT}}}};
+
+		inline constexpr First_Table_t<Term_t> term_first = {
+		    NO_TERM,
+		    {{LEAF_TERM,
+		      {LIT_CHAR, LIT_INT, LIT_FLOAT, LIT_DECIMAL, LIT_STRING, PLUS, LEFT_CARROT,
+		       RIGHT_CARROT, KEY_RET, KEY_JUMP, KEY_CALL}},
+		     {NAME_TERM, {IDENTIFIER, DOUBLE_COLON}},
+		     {GROUP_TERM, {LEFT_PAREN}},
+		     {VECTOR_TERM, {LEFT_SQUARE}},
+		     {BLOCK_TERM, {LEFT_BRACKET, INDENT}},
+		     {LAMBDA_TERM, {ARROW}},
+		     {IF_TERM, {KEY_IF}},
+		     {MATCH_TERM, {KEY_MATCH}},
+		     {DO_TERM, {KEY_DO}},
+		     {WITH_TERM, {KEY_WITH}}}};
+
+		static_assert(!element_first.ambiguous, "two elements start with the same token");
+		static_assert(!term_first.ambiguous, "two terms start with the same token");
+	}
+}
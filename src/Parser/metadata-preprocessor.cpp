@@ -1,7 +1,6 @@
 #include "../util.hpp"
 #include "parser.hpp"
 
-#include <algorithm>
 #include <functional>
 #include <string>
 
@@ -9,16 +8,31 @@
 // parser to know if a function call is pre or postfix. This also grabs and stores
 // help information on the functions for later use.
 void nip::parse::Parser::metadata_preprocessor() {
-	metadata_scan_abouts(0);
-	current = start; // Reset the current iterator back to normal
-	// metadata_scan_functors(0);
-	current = start; // Reset the current iterator back to normal
+	// A streamed program can only be read once, so its abouts are found as it goes
+	if (lexer) {
+		metadata_scan_abouts(0);
+		return;
+	}
+
+	declarations.build(*token_stream);
+	metadata_abouts();
+	// metadata_functors();
+	current_qualified_name.clear();
+	seek(start); // Reset the current iterator back to normal
+}
+
+// Moves the parser to just past the name of d, with the name's vocabularies as the current ones
+void nip::parse::Parser::metadata_seek(const nip::parse::Declaration_Index::Declaration_t& d) {
+	auto name = declarations.name(d);
+	current_qualified_name.assign(name.begin(), name.end() - 1);
+	seek(token_stream->at(d.token + 1 + d.synonym));
+	next_sym();
 }
 
 template <class Callback_t, class... Args>
 void nip::parse::Parser::metadata_vocab(Callback_t callback, Args&&... a) {
 	expect(IDENTIFIER, "expected identifier");
-	auto& tmp_name = token_caches.identifier[last_token_data];
+	nip::Symbol_t tmp_name = last_symbol.address;
 	if (accept(COLON, LEFT_BRACKET)) {
 		current_qualified_name.emplace_back(tmp_name);
 		accept(NEWLINE);
@@ -28,38 +42,18 @@ void nip::parse::Parser::metadata_vocab(Callback_t callback, Args&&... a) {
 	}
 }
 
-Functor_Pre_Info_t& nip::parse::Parser::metadata_get_functor_info(std::vector<std::string>& name,
+Functor_Pre_Info_t& nip::parse::Parser::metadata_get_functor_info(nip::Symbol_t name,
                                                                   bool about) {
-	auto found_element =
-	    std::find_if(functor_pre_info.begin(), functor_pre_info.end(), [&name](auto a) -> bool {
-		    if (a.name.size() == name.size()) {
-			    for (size_t i = 0; i < a.name.size(); i++) {
-				    if (a.name[i] != name[i]) {
-					    return false;
-				    }
-			    }
-			    return true;
-		    }
-		    return false;
-		});
+	// The qualified name is the current one for as long as it takes to look it up
+	bool added;
+	current_qualified_name.push_back(name);
+	Functor_Pre_Info_t& function = functor_pre_info.get(current_qualified_name, added);
+	current_qualified_name.pop_back();
 
-	if (found_element == functor_pre_info.end()) {
-		functor_pre_info.emplace_back();
-		functor_pre_info.back().name = name;
-		return functor_pre_info.back();
-	}
-	if (about) {
-		return (*found_element);
-	}
-	else {
-		if (found_element->declared) {
-			error("function redeclairation");
-			return (*found_element);
-		}
-		else {
-			return (*found_element);
-		}
+	if (!added && !about && function.declared) {
+		error("function redeclairation");
 	}
+	return function;
 }
 
 std::pair<size_t, size_t> nip::parse::Parser::metadata_parse_functor_args() {
@@ -69,6 +63,7 @@ std::pair<size_t, size_t> nip::parse::Parser::metadata_parse_functor_args() {
 	while (!accept(RIGHT_PAREN)) {
 		if (is(NUL)) {
 			error("Unexpected end of file");
+			break;
 		}
 		if (!is(ARROW) && arg_count == 0) {
 			arg_count = 1;
@@ -94,6 +89,10 @@ std::pair<size_t, size_t> nip::parse::Parser::metadata_parse_functor_args() {
 size_t nip::parse::Parser::metadata_parse_trait_args() {
 	size_t arg_count = 0;
 	while (!accept(RIGHT_CARROT)) {
+		if (is(NUL)) {
+			error("Unexpected end of file");
+			break;
+		}
 		if (arg_count == 0) {
 			arg_count = 1;
 		}
@@ -107,91 +106,84 @@ size_t nip::parse::Parser::metadata_parse_trait_args() {
 	return arg_count;
 }
 
-void nip::parse::Parser::metadata_scan_abouts(size_t start_indent) {
-	size_t indent_level = start_indent;
-	while (!is(NUL) && indent_level >= start_indent) {
-		if (accept(KEY_VOCAB)) {
-			metadata_vocab([&] { metadata_scan_abouts(indent_level + 1); });
-		}
-		else if (accept(KEY_ABOUT)) {
-			expect(IDENTIFIER, "expected identifier");
+// The fields of an about section, from the colon after its name. After an error the rest of the
+// about is skipped, so a scan can go on from the end of it.
+void nip::parse::Parser::metadata_about(Functor_Pre_Info_t& function) {
+	expect(COLON, "expected colon");
+	expect(NEWLINE, "expected newline");
+	bool body = expect(INDENT, "expected indent");
 
-			// Create current name
-			auto name = current_qualified_name;
-			name.push_back(token_caches.identifier[last_token_data]);
+	while (is(IDENTIFIER, KEY_DOCS, KEY_OP)) {
+		bool indented = false;
 
-			Functor_Pre_Info_t& function = metadata_get_functor_info(name, true);
+		if (accept(KEY_DOCS)) {
 			expect(COLON, "expected colon");
-			expect(NEWLINE, "expected newline");
-			expect(INDENT, "expected indent");
+			accept(NEWLINE);
+			indented = accept(INDENT);
 
-			while (is(IDENTIFIER, KEY_DOCS, KEY_OP)) {
-				bool indented = false;
+			if (accept(LIT_STRING)) {
+				function.documentation = static_cast<nip::Literal_t>(last_symbol.address);
+			}
+			while (!is(NUL) && !accept(NEWLINE))
+				next_sym();
+		}
 
-				if (accept(KEY_DOCS)) {
-					expect(COLON, "expected colon");
-					accept(NEWLINE);
-					indented = accept(INDENT);
+		else if (accept(KEY_OP)) {
+			expect(COLON, "expected colon");
+			accept(NEWLINE);
+			indented = accept(INDENT);
 
-					if (accept(LIT_STRING)) {
-						function.documentation = token_caches.identifier[last_token_data];
-					}
-					while (!accept(NEWLINE))
-						next_sym();
+			if (is(KEY_LEFT, KEY_RIGHT)) {
+				if (accept(KEY_LEFT)) {
+					function.calling_type = Functor_Pre_Info_t::INFIX_LEFT;
 				}
-
-				else if (accept(KEY_OP)) {
-					expect(COLON, "expected colon");
-					accept(NEWLINE);
-					indented = accept(INDENT);
-
-					if (is(KEY_LEFT, KEY_RIGHT)) {
-						if (accept(KEY_LEFT)) {
-							function.calling_type = Functor_Pre_Info_t::INFIX_LEFT;
-						}
-						else if (accept(KEY_RIGHT)) {
-							function.calling_type = Functor_Pre_Info_t::INFIX_RIGHT;
-						}
-						if (accept(LIT_INT)) {
-							function.presidence = token_caches.integer[last_token_data];
-						}
-					}
-					while (!accept(NEWLINE))
-						next_sym();
+				else if (accept(KEY_RIGHT)) {
+					function.calling_type = Functor_Pre_Info_t::INFIX_RIGHT;
 				}
+				if (accept(LIT_INT)) {
+					function.presidence = token_caches->integer[last_symbol.address];
+				}
+			}
+			while (!is(NUL) && !accept(NEWLINE))
+				next_sym();
+		}
 
-				else if (accept(IDENTIFIER)) {
-					std::vector<std::string>& right_term =
-					    function.about_pairs[token_caches.identifier[last_token_data]];
-					expect(COLON, "expected colon");
-					accept(NEWLINE);
-					indented = accept(INDENT);
-					while (!accept(NEWLINE)) {
-						switch (cur_symbol.type) {
-							case IDENTIFIER:
-								right_term.emplace_back(
-								    token_caches.identifier[cur_symbol.address]);
-								break;
-							case LIT_FLOAT:
-								right_term.emplace_back(
-								    std::to_string(token_caches.floating_pt[cur_symbol.address]));
-								break;
-							case LIT_INT:
-								right_term.emplace_back(
-								    std::to_string(token_caches.integer[cur_symbol.address]));
-								break;
-							default:
-								error("unexpected token");
-								break;
-						}
-						next_sym();
-					}
+		else if (accept(IDENTIFIER)) {
+			functor_pre_info.add_field(function, last_symbol.address);
+			expect(COLON, "expected colon");
+			accept(NEWLINE);
+			indented = accept(INDENT);
+			while (!is(NUL) && !accept(NEWLINE)) {
+				if (is(IDENTIFIER, LIT_FLOAT, LIT_INT, LIT_DECIMAL)) {
+					functor_pre_info.add_value(cur_symbol.type, cur_symbol.address);
 				}
-				if (indented) {
-					expect(DEDENT, "expected dedent");
+				else {
+					error("unexpected token");
 				}
+				next_sym();
 			}
 		}
+		if (indented) {
+			expect(DEDENT, "expected dedent");
+		}
+	}
+	if (panicking && recover()) {
+		skip_line(body);
+		return;
+	}
+	accept(DEDENT);
+}
+
+void nip::parse::Parser::metadata_scan_abouts(size_t start_indent) {
+	size_t indent_level = start_indent;
+	while (!is(NUL) && indent_level >= start_indent) {
+		if (accept(KEY_VOCAB)) {
+			metadata_vocab([&] { metadata_scan_abouts(indent_level + 1); });
+		}
+		else if (accept(KEY_ABOUT)) {
+			expect(IDENTIFIER, "expected identifier");
+			metadata_about(metadata_get_functor_info(last_symbol.address, true));
+		}
 
 		else if (accept(INDENT)) {
 			indent_level++;
@@ -204,63 +196,56 @@ void nip::parse::Parser::metadata_scan_abouts(size_t start_indent) {
 		else {
 			next_sym();
 		}
+
+		if (panicking && recover()) {
+			skip_line();
+		}
 	}
-	std::cerr << functor_pre_info.size() << '\n';
 }
 
-void nip::parse::Parser::metadata_scan_functors(size_t start_indent) {
-	size_t indent_level = start_indent;
-	while (!is(NUL) && indent_level >= start_indent) {
-		if (accept(KEY_VOCAB)) {
-			metadata_vocab([&] { metadata_scan_functors(indent_level + 1); });
+void nip::parse::Parser::metadata_abouts() {
+	for (const auto& d : declarations) {
+		if (d.keyword == KEY_ABOUT) {
+			metadata_seek(d);
+			metadata_about(metadata_get_functor_info(last_symbol.address, true));
+			if (panicking) {
+				return;
+			}
 		}
-		else if (accept(KEY_DEFINE)) {
-			expect(IDENTIFIER, "expected identifier");
+	}
+}
 
-			// Create current name
-			// TODO: FIX
-			auto name = current_qualified_name;
-			name.push_back(token_caches.identifier[last_token_data]);
+void nip::parse::Parser::metadata_functors() {
+	for (const auto& d : declarations) {
+		if (d.keyword == KEY_DEFINE) {
+			metadata_seek(d);
 
 			// Record function information into an appropriate struct.
-			Functor_Pre_Info_t& function = metadata_get_functor_info(name, false);
+			Functor_Pre_Info_t& function = metadata_get_functor_info(last_symbol.address, false);
 			expect(LEFT_PAREN, "expected left paren");
 			function.argument_count = metadata_parse_functor_args();
 		}
-		else if (accept(KEY_TRAIT)) {
-			expect(IDENTIFIER, "expected identifier");
-
-			// Create current name
-			// TODO: FIX
-			auto name = current_qualified_name;
-			name.push_back(token_caches.identifier[last_token_data]);
+		else if (d.keyword == KEY_TRAIT) {
+			metadata_seek(d);
 
 			// Record trait information into an appropriate struct.
-			Functor_Pre_Info_t& function = metadata_get_functor_info(name, false);
+			Functor_Pre_Info_t& function = metadata_get_functor_info(last_symbol.address, false);
 			expect(LEFT_CARROT, "expected left carrot");
 			function.trait_argument_count = metadata_parse_trait_args();
 			expect(LEFT_PAREN, "expected left paren");
 			function.argument_count = metadata_parse_functor_args();
 		}
-		else if (accept(INDENT)) {
-			indent_level++;
-		}
-		else if (accept(DEDENT)) {
-			indent_level--;
-		}
-		else {
-			next_sym();
+		if (panicking && !recover()) {
+			return;
 		}
 	}
-
-	std::cerr << functor_pre_info.size() << '\n';
 }
 
 void nip::parse::Parser::print_metadata_functor_info() {
 	for (auto& i : functor_pre_info) {
 		std::cerr << "         Name: ";
-		for (auto& name_part : i.name) {
-			std::cerr << name_part;
+		for (auto& name_part : functor_pre_info.name(i)) {
+			std::cerr << token_caches->identifier[name_part];
 		}
 		std::cerr << '\n';
 		std::cerr << "   Trait Args: " << i.trait_argument_count << '\n';
@@ -284,13 +269,33 @@ void nip::parse::Parser::print_metadata_functor_info() {
 		std::cerr << "     Declared: " << i.declared << '\n';
 		std::cerr << "      Abouted: " << i.abouted << '\n';
 		std::cerr << "  About Pairs: \n";
-		for (auto& about : i.about_pairs) {
-			std::cerr << '\t' << about.first << ": ";
-			for (auto& value : about.second) {
-				std::cerr << value << " ";
+		for (uint32_t id = i.first_field; id != Functor_Pre_Info_t::no_field;) {
+			const auto& field = functor_pre_info.field(id);
+			std::cerr << '\t' << token_caches->identifier[field.key] << ": ";
+			for (const auto& value : functor_pre_info.values(field)) {
+				switch (value.type) {
+					case IDENTIFIER:
+						std::cerr << token_caches->identifier[value.address];
+						break;
+					case LIT_FLOAT:
+						std::cerr << std::to_string(token_caches->floating_pt[value.address]);
+						break;
+					case LIT_INT:
+						std::cerr << token_caches->integer[value.address];
+						break;
+					case LIT_DECIMAL:
+						std::cerr << token_caches->decimal[value.address].to_string();
+						break;
+				}
+				std::cerr << " ";
 			}
 			std::cerr << '\n';
+			id = field.next;
+		}
+		std::cerr << "Documentation: ";
+		if (i.documentation != nip::Literal_Table::no_literal) {
+			std::cerr << nip::util::special_sanitize(token_caches->string[i.documentation]);
 		}
-		std::cerr << "Documentation: " << nip::util::special_sanitize(i.documentation) << "\n\n";
+		std::cerr << "\n\n";
 	}
 }
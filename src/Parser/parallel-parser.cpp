@@ -0,0 +1,121 @@
+#include "parser.hpp"
+
+#include "../Error/errorhandler.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace {
+	// Fewest tokens worth parsing on a thread of their own
+	constexpr size_t parallel_parse_chunk = 1 << 16;
+
+	struct Chunk_t {
+		size_t first = 0; // Token the chunk's first element starts at
+		size_t last  = 0; // Where the next chunk's starts
+
+		// Filled by the chunk's own parser
+		nip::ast::Syntax_Tree tree;
+		nip::error::Error_Handler errors;
+		bool overran = false; // It didn't end at last, so it can't stand in for a serial parse
+	};
+
+	// Runs fn on every chunk, each on its own thread
+	template <class Fn_t>
+	void for_each_chunk(std::vector<Chunk_t>& chunks, Fn_t fn) {
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < chunks.size(); i++) {
+			workers.emplace_back(fn, std::ref(chunks[i]));
+		}
+		fn(chunks[0]);
+		for (std::thread& w : workers) {
+			w.join();
+		}
+	}
+}
+
+// The top level elements are split into runs at declarations that start a line outside any
+// block, which the declaration index already has, so every run starts just where a serial parse
+// would start an element. Each run is parsed by a parser of its own into a tree of its own, and
+// the trees are then appended in order. A serial parse never skips past the start of a top level
+// element to recover from an error, so each run finds the errors it would, and they are copied
+// out in order up to the limit.
+bool nip::parse::Parser::parallel_program(size_t threads) {
+	size_t size = token_stream->size();
+	threads     = std::min(threads, size / parallel_parse_chunk);
+	if (threads < 2) {
+		return false;
+	}
+
+	// Split at the first declaration starting a line at the top level after each even share
+	std::vector<size_t> splits = {0};
+	auto d                     = declarations.begin();
+	for (size_t i = 1; i < threads; i++) {
+		size_t share = std::max(size * i / threads, splits.back() + 1);
+		d = std::find_if(d, declarations.end(), [&](const auto& at) {
+			return at.token >= share && starts_element(at);
+		});
+		if (d == declarations.end()) {
+			break;
+		}
+		splits.push_back(d->token);
+	}
+	splits.push_back(size);
+	if (splits.size() < 3) {
+		return false;
+	}
+
+	std::vector<Chunk_t> chunks(splits.size() - 1);
+	for (size_t i = 0; i < chunks.size(); i++) {
+		chunks[i].first = splits[i];
+		chunks[i].last  = splits[i + 1];
+	}
+
+	for_each_chunk(chunks, [this](Chunk_t& c) {
+		Parser worker(c.errors, opt, err_stream);
+		worker.token_caches = token_caches;
+		worker.token_stream = token_stream;
+		worker.operators    = operators;
+		worker.index        = index;
+		worker.tree         = &c.tree;
+		c.tree.set_tokens(token_stream);
+		c.tree.reserve(c.last - c.first);
+		worker.start = start;
+		worker.end   = end;
+		worker.seek(token_stream->at(c.first));
+		if (c.first) {
+			worker.last_symbol = (*token_stream)[c.first - 1];
+		}
+
+		if (c.first == 0) {
+			worker.newlines();
+		}
+		while (!worker.is(NUL) && worker.current_index() < c.last) {
+			worker.element();
+		}
+		// One that gave up at its own limit might have counted errors the merge drops
+		c.overran = worker.panicking || worker.current_index() != c.last;
+	});
+
+	// A run that didn't end on its split means the split was wrong, so the whole program is
+	// parsed again serially
+	if (std::any_of(chunks.begin(), chunks.end(), [](const Chunk_t& c) { return c.overran; })) {
+		return false;
+	}
+
+	for (Chunk_t& c : chunks) {
+		for (const nip::error::_Error& e : c.errors.errors()) {
+			if (reported < opt.error_limit && !reported_at(e.offset)) {
+				errhdlr.add_error(e.type, e.msg.data(), e.offset, e.has_location);
+				reported++;
+			}
+		}
+	}
+
+	auto elements = tree->open();
+	for (Chunk_t& c : chunks) {
+		tree->append(c.tree);
+	}
+	tree->close(elements, nip::ast::PROGRAM, 0);
+	return true;
+}
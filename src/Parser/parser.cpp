@@ -2,121 +2,358 @@
 
 #include "../Error/errorhandler.hpp"
 #include "../utilmacro.hpp"
-#include <exception>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
 
-Parse_Fatal_Error_t Parse_Fatal_Error;
+void nip::parse::Parser::parse(const nip::Compilation_Unit& unit, nip::ast::Syntax_Tree& t) {
+	token_caches = &unit.caches;
+	token_stream = &unit.tokens;
+	lexer        = nullptr;
+	tree         = &t;
+	tree->clear();
+	tree->reserve(token_stream->size());
+	tree->set_tokens(token_stream);
+	start = token_stream->begin();
+	end   = token_stream->end();
+	seek(start);
+	parse_program();
+}
 
-void nip::parse::Parser::parse(const std::vector<nip::Token_t>& tokens, const Token_Cache_t& tc) {
-	token_caches = tc;
-	start        = tokens.begin();
-	current      = start;
-	end          = tokens.end();
+void nip::parse::Parser::parse(nip::lex::Lexer& lex, const Token_Cache_t& tc) {
+	token_caches = &tc;
+	lexer        = &lex;
+	tree         = nullptr;
 	next_sym();
+	parse_program();
+}
 
-	try {
-		metadata_preprocessor();
-		// program();
-	}
-	catch (Parse_Fatal_Error_t e) {
+void nip::parse::Parser::parse_program() {
+	panicking   = false;
+	first_error = errhdlr.size();
+	reported    = 0;
+	metadata_preprocessor();
+	if (tree && !panicking) {
+		make_operator_table();
+		program();
+	}
+	// The lexer's errors, found before the parse or during it when streaming, fail the program
+	// as much as the parser's own do
+	if (errhdlr.size()) {
+		if (tree) {
+			tree->clear();
+		}
 		errhdlr.print_errors(*opt.error_stream);
-		return;
 	}
 }
 
 void nip::parse::Parser::program() {
-	while (!accept(NUL)) {
+	size_t threads = opt.parse_threads ? opt.parse_threads : std::thread::hardware_concurrency();
+	if (threads > 1 && parallel_program(threads)) {
+		return;
+	}
+
+	auto elements = tree->open();
+	newlines();
+	while (!is(NUL)) {
 		element();
 	}
+	tree->close(elements, nip::ast::PROGRAM, 0);
 }
 
 void nip::parse::Parser::element() {
-	if (accept(KEY_TRAIT)) {
-		trait_declaration();
-	}
-	else if (accept(KEY_INTRIN)) {
-		intrinsic_declaration();
-	}
-	else if (accept(KEY_DEFINE)) {
-		function_definition();
-	}
-	else if (accept(KEY_INSTANCE)) {
-		instance_definition();
-	}
-	else if (accept(KEY_PERMIT)) {
-		permission_definition();
+	size_t blocks   = block_type.size();
+	Element_t which = element_first[cur_symbol.type];
+	// Every element but a statement starts at its keyword
+	if (which > STATEMENT_ELEMENT) {
+		next_sym();
+	}
+	switch (which) {
+		case NO_ELEMENT:
+			break;
+		case STATEMENT_ELEMENT:
+			statement();
+			break;
+		case TRAIT_ELEMENT:
+			trait_declaration();
+			break;
+		case INTRINSIC_ELEMENT:
+			intrinsic_declaration();
+			break;
+		case DEFINITION_ELEMENT:
+			function_definition();
+			break;
+		case INSTANCE_ELEMENT:
+			instance_definition();
+			break;
+		case PERMISSION_ELEMENT:
+			permission_definition();
+			break;
+		case ABOUT_ELEMENT:
+			about_section();
+			break;
+		case TYPE_ELEMENT:
+			if (accept(KEY_SYNONYM)) {
+				type_synonym();
+			}
+			else {
+				type_definition();
+			}
+			break;
+		case VOCAB_ELEMENT:
+			if (accept(KEY_SYNONYM)) {
+				vocabulary_synonym();
+			}
+			else {
+				vocabulary_definition();
+			}
+			break;
+		case IMPORT_ELEMENT:
+			import_element();
+			break;
+		case EXPORT_ELEMENT:
+			// export_element(); // Not implimented
+			error("export isn't a supported language feature");
+			break;
 	}
-	else if (accept(KEY_ABOUT)) {
-		about_section();
+	endofstatement();
+	if (panicking) {
+		synchronize(blocks);
 	}
-	else if (accept(KEY_TYPE)) {
-		if (accept(KEY_SYNONYM)) {
-			type_synonym();
-		}
-		else {
-			type_definition();
+	newlines();
+}
+
+void nip::parse::Parser::statement() {
+	uint32_t at = current_index();
+	auto terms  = tree->open();
+	do {
+		expression();
+	} while (!is(NEWLINE, SEMI_COLON, RIGHT_BRACKET, DEDENT, NUL) && !line_ended());
+	tree->close(terms, nip::ast::STATEMENT, at);
+}
+
+// Every functor whose about gives it an operator precedence, where the same name in two
+// vocabularies takes the first
+void nip::parse::Parser::make_operator_table() {
+	operator_table.assign(token_caches->identifier.size(), Operator_t{});
+	for (const auto& f : functor_pre_info) {
+		nip::Symbol_t name = functor_pre_info.name(f).back();
+		if (f.calling_type == Functor_Pre_Info_t::POSTFIX || operator_table[name].power) {
+			continue;
 		}
+		intmax_t power       = std::clamp<intmax_t>(f.presidence + 1, 1, UINT8_MAX);
+		operator_table[name] = {static_cast<uint8_t>(power),
+		                        f.calling_type == Functor_Pre_Info_t::INFIX_RIGHT};
 	}
-	else if (accept(KEY_VOCAB)) {
-		if (accept(KEY_SYNONYM)) {
-			vocabulary_synonym();
+	operators = operator_table.data();
+}
+
+// A term, and then any infix operators binding at least min_power with their right operands, by
+// precedence climbing. An operator only takes operands when there is a term on both sides of it,
+// so one at the end of a line or in a section like (+ 1) is just a word.
+void nip::parse::Parser::expression(uint8_t min_power) {
+	auto operands = tree->open();
+	term();
+	while (is(IDENTIFIER) && !line_ended()) {
+		Operator_t op = operators[cur_symbol.address];
+		if (op.power < min_power) {
+			break;
 		}
-		else {
-			vocabulary_definition();
+		size_t after     = current_index() + 1;
+		TokenType_t next = after < token_stream->size() ? token_stream->type(after) : NUL;
+		if (next == DOUBLE_COLON || !starts_term(next)) {
+			break;
 		}
+		uint32_t at = current_index();
+		next_sym();
+		expression(op.right ? op.power : op.power + 1);
+		tree->close(operands, nip::ast::INFIX, at);
 	}
-	else if (accept(KEY_IMPORT)) {
-		import_element();
+}
+
+bool nip::parse::Parser::starts_term(nip::TokenType_t tt) {
+	return term_first.first.contains(tt);
+}
+
+void nip::parse::Parser::term() {
+	Term_t which = term_first[cur_symbol.type];
+	// Names and blocks read their first token themselves
+	if (which != NAME_TERM && which != BLOCK_TERM && which != NO_TERM) {
+		next_sym();
+	}
+	switch (which) {
+		case NO_TERM:
+			error(is(NUL) ? "unexpected end of file" : "unexpected token");
+			break;
+		case LEAF_TERM:
+			leaf();
+			break;
+		case NAME_TERM:
+			qualified_name();
+			break;
+		case GROUP_TERM:
+			group_term();
+			break;
+		case VECTOR_TERM:
+			vector_term();
+			break;
+		case BLOCK_TERM:
+			generic_block();
+			break;
+		case LAMBDA_TERM:
+			lambda_term();
+			break;
+		case IF_TERM:
+			if_term();
+			break;
+		case MATCH_TERM:
+			match_term();
+			break;
+		case DO_TERM:
+			do_term();
+			break;
+		case WITH_TERM:
+			with_term();
+			break;
 	}
-	else if (accept(KEY_EXPORT)) {
-		// export_element(); // Not implimented
-		error("export isn't a supported language feature");
+}
+
+void nip::parse::Parser::group_term() {
+	uint32_t at = last_index();
+	auto terms  = tree->open();
+	while (!is(RIGHT_PAREN, NUL)) {
+		expression();
+	}
+	expect(RIGHT_PAREN, "unexpected end of file");
+	tree->close(terms, nip::ast::GROUP, at);
+}
+
+// Items of more than one term are grouped, so every child is one item
+void nip::parse::Parser::vector_term() {
+	uint32_t at = last_index();
+	auto items  = tree->open();
+	if (!accept(RIGHT_SQUARE)) {
+		do {
+			uint32_t item_at = current_index();
+			auto terms       = tree->open();
+			do {
+				expression();
+			} while (!is(COMMA, RIGHT_SQUARE, NUL));
+			if (tree->open() - terms > 1) {
+				tree->close(terms, nip::ast::GROUP, item_at);
+			}
+		} while (accept(COMMA) && !is(RIGHT_SQUARE));
+		expect(RIGHT_SQUARE, "expected ]");
 	}
-	else {
-		while (!is(NEWLINE, SEMI_COLON)) {
-			term();
+	tree->close(items, nip::ast::VECTOR, at);
+}
+
+void nip::parse::Parser::lambda_term() {
+	uint32_t at = last_index();
+	auto names  = tree->open();
+	do {
+		if (expect(IDENTIFIER, "expected identifier")) {
+			tree->leaf(nip::ast::PARAMETER, last_index());
 		}
-	}
-	endofstatement();
-	newlines();
+	} while (accept(COMMA));
+	accept(SEMI_COLON);
+	tree->close(names, nip::ast::LAMBDA, at);
 }
 
-void nip::parse::Parser::term() {
-	if (accept(LIT_CHAR)) {
-		; // Make a character literal
-	}
-	else if (accept(LIT_INT)) {
-		; // Make a integer literal
+void nip::parse::Parser::if_term() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (accept(LEFT_PAREN)) {
+		group_term();
+	}
+	generic_block();
+	while (continues(KEY_ELIF)) {
+		uint32_t elif_at = last_index();
+		auto elif        = tree->open();
+		if (accept(LEFT_PAREN)) {
+			group_term();
+		}
+		generic_block();
+		tree->close(elif, nip::ast::ELIF, elif_at);
 	}
-	else if (accept(LIT_FLOAT)) {
-		; // Make a floating point literal
+	if (continues(KEY_ELSE)) {
+		uint32_t else_at = last_index();
+		auto otherwise   = tree->open();
+		generic_block();
+		tree->close(otherwise, nip::ast::ELSE, else_at);
 	}
-	else if (accept(LIT_STRING)) {
-		; // Make a string literal
+	tree->close(parts, nip::ast::IF, at);
+}
+
+void nip::parse::Parser::match_term() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (accept(LEFT_PAREN)) {
+		group_term();
 	}
-	else if (is(IDENTIFIER)) {
+	while (continues(KEY_CASE)) {
+		uint32_t case_at = last_index();
+		auto arm         = tree->open();
 		qualified_name();
-	}
-	else if (accept(LEFT_PAREN)) { // Look more into this later
-		if (is(IDENTIFIER)) {
-			qualified_name();
-			while (!accept(RIGHT_PAREN)) {
-				term();
-			}
-		}
-		else {
-			while (!accept(RIGHT_PAREN)) {
-				term();
-			}
+		if (accept(ARROW)) {
+			lambda_term();
 		}
+		generic_block();
+		tree->close(arm, nip::ast::CASE, case_at);
+	}
+	if (continues(KEY_ELSE)) {
+		uint32_t else_at = last_index();
+		auto otherwise   = tree->open();
+		generic_block();
+		tree->close(otherwise, nip::ast::ELSE, else_at);
+	}
+	tree->close(parts, nip::ast::MATCH, at);
+}
+
+void nip::parse::Parser::do_term() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (expect(LEFT_PAREN, "expected (")) {
+		group_term();
+	}
+	generic_block();
+	tree->close(parts, nip::ast::DO, at);
+}
+
+void nip::parse::Parser::with_term() {
+	uint32_t at = last_index();
+	auto names  = tree->open();
+	expect(LEFT_PAREN, "expected (");
+	while (!is(RIGHT_PAREN, NUL)) {
+		accept(PLUS);
+		permission_name();
 	}
+	expect(RIGHT_PAREN, "unexpected end of file");
+	tree->close(names, nip::ast::WITH, at);
+}
+
+// Looks for tt past the end of the line, for terms like if that can go on over several. Once
+// the newlines are gone the line has ended, which endofstatement() knows to allow.
+bool nip::parse::Parser::continues(nip::TokenType_t tt) {
+	newlines();
+	return accept(tt);
 }
 
 void nip::parse::Parser::import_element() {
-	block_start();
-	while (!is(DEDENT, RIGHT_BRACKET)) {
+	uint32_t at = last_index();
+	auto names  = tree->open();
+	if (is(LEFT_BRACKET, COLON)) {
+		block_start();
+		while (!is(DEDENT, RIGHT_BRACKET, NUL)) {
+			import_name();
+			newlines();
+		}
+		block_end();
+	}
+	else {
 		import_name();
 	}
-	block_end();
+	tree->close(names, nip::ast::IMPORT, at);
 }
 
 void nip::parse::Parser::export_element() {
@@ -124,115 +361,210 @@ void nip::parse::Parser::export_element() {
 }
 
 void nip::parse::Parser::trait_declaration() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (expect(IDENTIFIER, "expected identifier")) {
-		trait_arguments();
+		leaf();
+		if (accept(LEFT_CARROT)) {
+			trait_arguments();
+		}
 		signature();
 	}
+	tree->close(parts, nip::ast::TRAIT, at);
 }
 
 void nip::parse::Parser::intrinsic_declaration() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
 		signature();
 	}
+	tree->close(parts, nip::ast::INTRINSIC, at);
 }
 
 void nip::parse::Parser::function_definition() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
+		if (accept(LEFT_CARROT)) {
+			trait_arguments();
+		}
 		signature();
 		generic_block();
 	}
+	tree->close(parts, nip::ast::DEFINITION, at);
 }
 
 void nip::parse::Parser::instance_definition() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
+		if (accept(LEFT_CARROT)) {
+			trait_arguments();
+		}
 		signature();
 		generic_block();
 	}
+	tree->close(parts, nip::ast::INSTANCE, at);
 }
 
 void nip::parse::Parser::permission_definition() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
 		signature();
 		generic_block();
 	}
+	tree->close(parts, nip::ast::PERMISSION, at);
 }
 
 void nip::parse::Parser::type_definition() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (accept(IDENTIFIER)) {
+		leaf();
+		if (accept(LEFT_CARROT)) {
+			trait_arguments();
+		}
 		block_start();
 		while (accept(KEY_CASE)) {
-			type_name();
-			newlines();
+			type_case();
 		}
+		block_end();
 	}
 	else {
 		error("expected identifier");
 	}
+	tree->close(parts, nip::ast::TYPE, at);
+}
+
+void nip::parse::Parser::type_case() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
+	}
+	if (accept(LEFT_PAREN) && !accept(RIGHT_PAREN)) {
+		do {
+			type_name();
+		} while (accept(COMMA));
+		expect(RIGHT_PAREN, "expected )");
+	}
+	newlines();
+	tree->close(parts, nip::ast::TYPE_CASE, at);
 }
 
 void nip::parse::Parser::about_section() {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
 	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
 		block_start();
-		while (is(DEDENT, RIGHT_BRACKET)) {
+		while (!is(DEDENT, RIGHT_BRACKET, NUL)) {
 			metadata_field();
 		}
 		block_end();
 	}
+	tree->close(parts, nip::ast::ABOUT, at);
 }
 
+// A field's values either follow its colon on the same line, or sit on the lines after it,
+// indented
 void nip::parse::Parser::metadata_field() {
 	if (accept(KEY_DOCS)) {
+		bool indented = field_start();
 		if (expect(LIT_STRING, "expected string literal")) {
-			; // Add documentation string
+			tree->leaf(nip::ast::DOCUMENTATION, last_index());
 		}
+		field_end(indented);
 	}
 	else if (accept(KEY_OP)) {
-		if (accept(KEY_LEFT)) {
-			if (accept(LIT_INT)) {
-				; // Add left-assosiative operator with appropriate precidence.
-			}
-		}
-		else if (accept(KEY_RIGHT)) {
-			if (accept(LIT_INT)) {
-				; // Add right-assosiative operator with appropriate precidence.
+		bool indented = field_start();
+		auto value    = tree->open();
+		if (accept(KEY_LEFT, KEY_RIGHT)) {
+			uint32_t associativity = last_index();
+			if (expect(LIT_INT, "expected precedence")) {
+				leaf();
 			}
+			tree->close(value, nip::ast::OPERATOR, associativity);
 		}
 		else {
-			// Add general data
+			error("expected left or right");
 		}
+		field_end(indented);
 	}
 	else if (accept(IDENTIFIER)) {
-		newlines();
+		uint32_t key  = last_index();
+		bool indented = field_start();
+		auto values   = tree->open();
+		while (!is(NEWLINE, SEMI_COLON, DEDENT, NUL)) {
+			term();
+		}
+		tree->close(values, nip::ast::METADATA_FIELD, key);
+		field_end(indented);
 	}
 	else {
 		error("expected identifier");
 	}
 }
 
+bool nip::parse::Parser::field_start() {
+	expect(COLON, "expected colon");
+	accept(NEWLINE);
+	return accept(INDENT);
+}
+
+void nip::parse::Parser::field_end(bool indented) {
+	endofstatement();
+	if (indented && !is(NUL)) {
+		expect(DEDENT, "expected dedent");
+	}
+}
+
 void nip::parse::Parser::word_synonym() {
 	expect(IDENTIFIER, "expected identifier");
 	qualified_name();
 }
 
 void nip::parse::Parser::type_synonym() {
-	expect(IDENTIFIER, "expected identifier");
-	qualified_name();
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
+	}
+	type_name();
+	tree->close(parts, nip::ast::TYPE_SYNONYM, at);
 }
 
 void nip::parse::Parser::vocabulary_synonym() {
-	expect(IDENTIFIER, "expected identifier");
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (expect(IDENTIFIER, "expected identifier")) {
+		leaf();
+	}
 	qualified_name();
+	tree->close(parts, nip::ast::VOCABULARY_SYNONYM, at);
 }
 
 void nip::parse::Parser::import_name() {
-	if (is(IDENTIFIER)) {
+	if (is(IDENTIFIER, DOUBLE_COLON)) {
 		qualified_name();
 	}
 	else if (accept(KEY_TYPE)) {
+		uint32_t at = last_index();
+		auto name   = tree->open();
 		qualified_name();
+		tree->close(name, nip::ast::IMPORT_TYPE, at);
 	}
 	else if (accept(KEY_VOCAB)) {
+		uint32_t at = last_index();
+		auto name   = tree->open();
 		qualified_name();
+		tree->close(name, nip::ast::IMPORT_VOCABULARY, at);
 	}
 	else {
 		error("expected qualified name, \"vocab\" or \"type\"");
@@ -240,47 +572,58 @@ void nip::parse::Parser::import_name() {
 }
 
 void nip::parse::Parser::vocabulary_definition() {
-	if (accept(IDENTIFIER)) {
-		if (accept(SEMI_COLON)) {
-			return;
-		}
-		else {
+	uint32_t at = last_index();
+	auto parts  = tree->open();
+	if (is(IDENTIFIER, DOUBLE_COLON)) {
+		qualified_name();
+		if (!accept(SEMI_COLON)) {
 			generic_block();
 		}
 	}
 	else {
 		error("expected indentifier");
 	}
+	tree->close(parts, nip::ast::VOCABULARY, at);
 }
 
 ALWAYS_INLINE void nip::parse::Parser::generic_block() {
+	uint32_t at   = current_index();
+	auto elements = tree->open();
 	block_start();
-	while (!is(RIGHT_BRACKET, DEDENT)) {
+	while (!is(RIGHT_BRACKET, DEDENT, NUL)) {
 		element();
 	}
 	block_end();
+	tree->close(elements, nip::ast::BLOCK, at);
 }
 
 void nip::parse::Parser::block_start() {
 	if (accept(LEFT_BRACKET)) {
-		block_type.push_back(BRACKETS);
 		newlines();
+		block_type.push_back(accept(INDENT) ? INDENTED_BRACKETS : BRACKETS);
 	}
 	else if (accept(COLON)) {
-		block_type.push_back(INDENTATION);
 		newlines();
 		if (expect(INDENT, "expected indent")) {
-			return;
+			block_type.push_back(INDENTATION);
 		}
 	}
+	else if (accept(INDENT)) {
+		block_type.push_back(INDENTATION);
+	}
 	else {
 		error("expected the start of a block");
 	}
 }
 
+// The input can end in the middle of an indented block, since no dedents are made at the end.
+// After an error the block may never have started, so synchronize() drops it instead.
 void nip::parse::Parser::block_end() {
+	if (panicking) {
+		return;
+	}
 	if (block_type.back() == INDENTATION) {
-		if (expect(DEDENT, "expected dedent")) {
+		if (is(NUL) || expect(DEDENT, "expected dedent")) {
 			block_type.pop_back();
 		}
 	}
@@ -289,45 +632,102 @@ void nip::parse::Parser::block_end() {
 			block_type.pop_back();
 		}
 	}
+	else if (block_type.back() == INDENTED_BRACKETS) {
+		if (expect(DEDENT, "expected dedent")) {
+			block_type.back() = BRACKETS; // Only the } is left
+			newlines();
+			if (expect(RIGHT_BRACKET, "expected right bracket")) {
+				block_type.pop_back();
+			}
+		}
+	}
 }
 
+// The node is the last name, and its children the vocabularies before it. An unqualified name
+// is only its token.
 void nip::parse::Parser::qualified_name() {
-	do {
-		if (expect(IDENTIFIER, "expected identifier")) {
-			;
-		}
-	} while (accept(DOUBLE_COLON));
+	auto qualifiers = tree->open();
+	if (accept(DOUBLE_COLON)) {
+		leaf();
+	}
+	expect(IDENTIFIER, "expected identifier");
+	uint32_t name = last_index();
+	while (accept(DOUBLE_COLON)) {
+		tree->leaf(name);
+		expect(IDENTIFIER, "expected identifier");
+		name = last_index();
+	}
+	if (tree->open() == qualifiers) {
+		tree->leaf(name);
+	}
+	else {
+		tree->close(qualifiers, nip::ast::NAME, name);
+	}
 }
 
+void nip::parse::Parser::permission_name() {
+	uint32_t at = current_index();
+	auto name   = tree->open();
+	qualified_name();
+	tree->close(name, nip::ast::PERMISSION_NAME, at);
+}
+
+// The <...> after a declared name, with the < already accepted
 void nip::parse::Parser::trait_arguments() {
+	uint32_t at = last_index();
+	auto names  = tree->open();
 	do {
 		if (expect(IDENTIFIER, "expected identifier")) {
-			;
+			tree->leaf(nip::ast::PARAMETER, last_index());
 		}
 	} while (accept(COMMA));
-	accept(RIGHT_CARROT);
+	expect(RIGHT_CARROT, "expected >");
+	tree->close(names, nip::ast::TYPE_PARAMETERS, at);
 }
 
 void nip::parse::Parser::type_name() {
+	if (accept(LEFT_PAREN)) {
+		signature_types();
+		return;
+	}
+	uint32_t at = current_index();
+	auto parts  = tree->open();
 	qualified_name();
 	if (accept(LEFT_CARROT)) {
-		trait_arguments();
-	}
-	if (accept(LEFT_PAREN)) {
 		do {
-			expect(IDENTIFIER, "expected identifier");
+			type_name();
 		} while (accept(COMMA));
-		expect(RIGHT_PAREN);
+		expect(RIGHT_CARROT, "expected >");
+		tree->close(parts, nip::ast::TYPE_APPLICATION, at);
 	}
 }
 
 void nip::parse::Parser::signature() {
-	expect(LEFT_PAREN, "expected (");
-	do {
-		expect(IDENTIFIER, "expected identifier");
-	} while (accept(COMMA));
-	expect(RIGHT_PAREN, "expected )");
-	expect(ARROW, "expected ->");
+	if (expect(LEFT_PAREN, "expected (")) {
+		signature_types();
+	}
+}
+
+// Everything up to the ) matching the ( accepted last
+void nip::parse::Parser::signature_types() {
+	uint32_t at = last_index();
+	auto types  = tree->open();
+	while (!is(RIGHT_PAREN, NUL)) {
+		if (accept(ARROW)) {
+			leaf();
+		}
+		else if (accept(PLUS)) {
+			permission_name();
+		}
+		else if (is(IDENTIFIER, DOUBLE_COLON, LEFT_PAREN)) {
+			type_name();
+		}
+		else if (!accept(COMMA)) {
+			error("expected a type");
+		}
+	}
+	expect(RIGHT_PAREN, "unexpected end of file");
+	tree->close(types, nip::ast::SIGNATURE, at);
 }
 
 void nip::parse::Parser::endofstatement() {
@@ -337,7 +737,133 @@ void nip::parse::Parser::endofstatement() {
 	else if (accept(SEMI_COLON)) {
 		return;
 	}
+	else if (is(RIGHT_BRACKET, DEDENT, NUL) || line_ended()) {
+		return;
+	}
 	else {
 		error("end of statement expected", nip::error::FATAL_ERROR);
 	}
 }
+
+// Only the first error of a construct is reported, and it stops the element it is in
+void nip::parse::Parser::error(const char* msg, nip::error::_Error_Type et) {
+	if (panicking) {
+		return;
+	}
+	if (reported < opt.error_limit && !reported_at(cur_symbol.offset)) {
+		errhdlr.add_error(et, msg, cur_symbol.offset, true);
+		reported++;
+	}
+	if (et == nip::error::FATAL_ERROR) {
+		panic();
+	}
+}
+
+// The metadata pass and the parse go over the abouts twice, so the same mistake can be found
+// twice
+bool nip::parse::Parser::reported_at(size_t offset) const {
+	const auto& errors = errhdlr.errors();
+	return std::any_of(errors.begin() + first_error, errors.end(),
+	                   [offset](const nip::error::_Error& e) { return e.offset == offset; });
+}
+
+void nip::parse::Parser::panic() {
+	panicking        = true;
+	held_symbol      = cur_symbol;
+	held_last_symbol = last_symbol;
+	held_position    = current;
+	current          = end;
+	cur_symbol       = nip::Token_t(NUL);
+}
+
+// Back to the token the error was found at, unless there have been too many errors
+bool nip::parse::Parser::recover() {
+	if (reported >= opt.error_limit) {
+		return false;
+	}
+	panicking   = false;
+	cur_symbol  = held_symbol;
+	last_symbol = held_last_symbol;
+	current     = held_position;
+	return true;
+}
+
+// Skips to where parsing can go on after an error: past the end of the line and any block it
+// starts, or up to the end of the block, at the depth the error was found. When the error was in
+// indented blocks that are still open, those are skipped to their end instead. Indents always
+// match, since the lexer makes them, but brackets are the programmer's, so a } that closes
+// nothing in an indented block is skipped. It also stops at the next top level element, for a
+// block that never ends, and says whether it did.
+bool nip::parse::Parser::skip_line(size_t indents) {
+	size_t stop     = lexer ? SIZE_MAX : next_element(current_index());
+	bool in_block   = indents;
+	size_t brackets = 0;
+	while (!is(NUL) && (lexer || current_index() != stop)) {
+		if (is(INDENT)) {
+			indents++;
+		}
+		else if (is(LEFT_BRACKET)) {
+			brackets++;
+		}
+		else if (is(DEDENT)) {
+			if (indents == 0) {
+				return false;
+			}
+			if (--indents == 0 && in_block) {
+				next_sym();
+				return false;
+			}
+		}
+		else if (is(RIGHT_BRACKET)) {
+			if (brackets) {
+				brackets--;
+			}
+			else if (indents == 0) {
+				return false;
+			}
+		}
+		else if (indents == 0 && brackets == 0 && is(NEWLINE, SEMI_COLON)) {
+			next_sym();
+			if (!is(INDENT)) {
+				return false;
+			}
+			in_block = true; // The block the line starts
+			continue;
+		}
+		next_sym();
+	}
+	return !is(NUL);
+}
+
+// Picks the parse up again after an error in an element that started with blocks open. When the
+// error was skipped up to the next top level element, the elements holding this one are stopped
+// too, until the top level one is.
+void nip::parse::Parser::synchronize(size_t blocks) {
+	size_t indents = 0;
+	for (size_t i = blocks; i < block_type.size(); i++) {
+		indents += block_type[i] != BRACKETS;
+	}
+	block_type.resize(blocks);
+	if (!recover()) {
+		return;
+	}
+	if (skip_line(indents) && blocks) {
+		panic();
+	}
+	else if (!blocks && is(DEDENT, RIGHT_BRACKET)) {
+		next_sym(); // Closes nothing
+	}
+}
+
+bool nip::parse::Parser::starts_element(
+    const nip::parse::Declaration_Index::Declaration_t& d) const {
+	TokenType_t before = d.token ? token_stream->type(d.token - 1) : NEWLINE;
+	return d.depth == 0 && (before == NEWLINE || before == DEDENT);
+}
+
+size_t nip::parse::Parser::next_element(size_t token) const {
+	auto d = std::lower_bound(index->begin(), index->end(), token,
+	                          [](const auto& at, size_t t) { return at.token < t; });
+	d      = std::find_if(d, index->end(), [this](const auto& at) { return starts_element(at); });
+	return d != index->end() ? d->token : SIZE_MAX;
+}
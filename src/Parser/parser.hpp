@@ -1,35 +1,34 @@
 #pragma once
 
+#include "../AST/syntaxtree.hpp"
+#include "../compilationunit.hpp"
 #include "../Error/errorhandler.hpp"
+#include "../Lexer/lexer.hpp"
 #include "../options.hpp"
 #include "../token.hpp"
+#include "../tokenstream.hpp"
 #include "../utilmacro.hpp"
+#include "declarationindex.hpp"
+#include "functortable.hpp"
+#include "grammar.hpp"
 
 #include <iosfwd>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
-struct Functor_Pre_Info_t {
-	std::vector<std::string> name;
-	size_t trait_argument_count = 0;
-	std::pair<size_t, size_t> argument_count = std::make_pair(size_t{0}, size_t{0});
-	enum : uint8_t { INFIX_LEFT, INFIX_RIGHT, POSTFIX } calling_type = POSTFIX;
-	intmax_t presidence = 0;
-	bool declared       = false;
-	bool abouted        = false;
-	std::unordered_map<std::string, std::vector<std::string>> about_pairs;
-	std::string documentation;
-};
-
 namespace nip {
 	namespace parse {
 		class Parser {
 		  public:
 			Parser(nip::error::Error_Handler& e, nip::Options& o, std::ostream& err)
 			    : errhdlr(e), opt(o), err_stream(err), cur_symbol(NUL){};
-			void parse(const std::vector<nip::Token_t>&, const Token_Cache_t&);
+			// Builds the program's syntax tree into tree, which is cleared first and left empty if
+			// the program doesn't lex or parse. Every error found is reported, up to opt.error_limit.
+			// The unit is only read, and must outlive the tree.
+			void parse(const nip::Compilation_Unit& unit, nip::ast::Syntax_Tree& tree);
+			// Only runs the metadata pass, see lexer below
+			void parse(nip::lex::Lexer&, const Token_Cache_t&);
 			void print_metadata_functor_info();
 
 		  private:
@@ -37,31 +36,77 @@ namespace nip {
 			nip::Options& opt;
 			std::ostream& err_stream;
 			nip::Token_t cur_symbol;
-			size_t last_token_data = 0;
+			nip::Token_t last_symbol; // The token accepted last
+
+			const nip::Token_Stream* token_stream = nullptr;
+			nip::Token_Stream::const_iterator start, current, end;
+			const Token_Cache_t* token_caches = nullptr;
+
+			// When set, tokens are pulled from the lexer as they are needed instead of read from a
+			// Token_Stream. The caches fill up as it goes, which is why they aren't copied. A
+			// pulled program can't be rewound, so only single pass phases run on it.
+			nip::lex::Lexer* lexer = nullptr;
 
-			std::vector<nip::Token_t>::const_iterator start, current, end;
-			Token_Cache_t token_caches;
+			nip::ast::Syntax_Tree* tree = nullptr;
+
+			// How tightly an infix operator holds its operands, by the Symbol_t of its name. A
+			// power of 0 isn't an operator, and otherwise it is the about's precedence plus one.
+			struct Operator_t {
+				uint8_t power = 0;
+				bool right    = false; // Associative
+			};
+			std::vector<Operator_t> operator_table;
+			const Operator_t* operators = nullptr; // This parser's table, or the one it works for
+			void make_operator_table();
+
+			void parse_program();
 
 			// METADATA PRE-PARSE
-			std::vector<std::string> current_qualified_name;
+			std::vector<nip::Symbol_t> current_qualified_name;
+			nip::parse::Declaration_Index declarations;
 			void metadata_preprocessor();
+			void metadata_seek(const nip::parse::Declaration_Index::Declaration_t& d);
+			void metadata_abouts();
+			void metadata_functors();
 			void metadata_scan_abouts(size_t start_indent);
-			void metadata_scan_functors(size_t start_indent);
+			void metadata_about(Functor_Pre_Info_t& function);
 			std::pair<size_t, size_t> metadata_parse_functor_args();
 			size_t metadata_parse_trait_args();
 			template <class Callback_t, class... Args>
 			void metadata_vocab(Callback_t callback, Args&&... a);
 
-			std::vector<Functor_Pre_Info_t> functor_pre_info;
-			Functor_Pre_Info_t& metadata_get_functor_info(std::vector<std::string>& name,
-			                                              bool about);
+			const nip::parse::Declaration_Index* index = &declarations; // Or the one it works for
+
+			nip::parse::Functor_Table functor_pre_info;
+			// The functor called name in the current vocabulary
+			Functor_Pre_Info_t& metadata_get_functor_info(nip::Symbol_t name, bool about);
 
-			enum blocktype_t : bool { INDENTATION, BRACKETS };
+			// Brackets around an indented block are taken to hold the INDENT and DEDENT too
+			enum blocktype_t : uint8_t { INDENTATION, BRACKETS, INDENTED_BRACKETS };
 			std::vector<blocktype_t> block_type;
 
+			// ERROR RECOVERY
+			// A fatal error stops the element it is in. The parser reads as if the input had
+			// ended, so everything parsing the element returns the ordinary way, and then
+			// synchronize() picks the parse up again past the error. Nothing is thrown.
+			bool panicking = false;
+			nip::Token_t held_symbol, held_last_symbol;
+			nip::Token_Stream::const_iterator held_position;
+			size_t first_error = 0; // Where this parse's errors start in errhdlr
+			size_t reported    = 0; // Once it reaches opt.error_limit the parse stays stopped
+			void panic();
+			bool recover();
+			bool skip_line(size_t indents = 0);
+			void synchronize(size_t blocks);
+			bool reported_at(size_t offset) const;
+			// Whether d is a top level element, and where the next one at or after token starts
+			bool starts_element(const nip::parse::Declaration_Index::Declaration_t& d) const;
+			size_t next_element(size_t token) const;
+
 			ALWAYS_INLINE void next_sym();
-			ALWAYS_INLINE void error(const char* msg,
-			                         nip::error::_Error_Type et = nip::error::FATAL_ERROR);
+			ALWAYS_INLINE void seek(nip::Token_Stream::const_iterator);
+			NEVER_INLINE void error(const char* msg,
+			                        nip::error::_Error_Type et = nip::error::FATAL_ERROR);
 			template <class... Args>
 			ALWAYS_INLINE bool is(nip::TokenType_t, nip::TokenType_t, Args...);
 			ALWAYS_INLINE bool is(nip::TokenType_t);
@@ -70,13 +115,27 @@ namespace nip {
 			ALWAYS_INLINE bool accept(nip::TokenType_t);
 			ALWAYS_INLINE bool expect(nip::TokenType_t tt, const char* msg = "unexpected token",
 			                          nip::error::_Error_Type et = nip::error::FATAL_ERROR);
+			// Positions in the Token_Stream, of cur_symbol and of the token accepted before it
+			ALWAYS_INLINE uint32_t current_index();
+			ALWAYS_INLINE uint32_t last_index();
+			// Makes the token accepted last a leaf of the tree
+			ALWAYS_INLINE void leaf();
+			ALWAYS_INLINE bool line_ended();
+			bool continues(nip::TokenType_t tt);
 
 			void program();
+			// Parses runs of top level elements on threads of their own and joins their trees in
+			// order. False if the program couldn't be split, with nothing made. See
+			// parallel-parser.cpp.
+			bool parallel_program(size_t threads);
 
 			// Elements
 			void element();
 			void import_element();
 			void export_element();
+			void statement();
+			void expression(uint8_t min_power = 1);
+			bool starts_term(nip::TokenType_t tt);
 			void term();
 
 			// Declarations
@@ -93,6 +152,8 @@ namespace nip {
 			// Metadata
 			void about_section();
 			void metadata_field();
+			bool field_start();
+			void field_end(bool indented);
 
 			// Synonym
 			void word_synonym();
@@ -103,16 +164,12 @@ namespace nip {
 			void import_name();
 
 			// Terms
-			void literal_term();
-			void word_term();
-			void section_term();
 			void group_term();
 			void vector_term();
 			void lambda_term();
 			void match_term();
 			void if_term();
 			void do_term();
-			void block_term();
 			void with_term();
 
 			// General stuff
@@ -120,24 +177,16 @@ namespace nip {
 			void block_start();
 			void block_end();
 			void qualified_name();
+			void permission_name();
 			void trait_arguments();
 			void type_name();
+			void type_case();
 			void signature();
+			void signature_types();
 			void endofstatement();
 			void newlines();
 		};
 	}
 }
 
-class Parse_Fatal_Error_t : public std::exception {
-  public:
-	const char* what() const throw() {
-		return "There was a parser error\n";
-	}
-};
-
-extern Parse_Fatal_Error_t Parse_Fatal_Error;
-
-// This structure holds information on functions so they can be properly called
-
 #include "parserfunc.tpp"
@@ -3,13 +3,11 @@
 template <class... Args>
 ALWAYS_INLINE bool nip::parse::Parser::accept(nip::TokenType_t tt1, nip::TokenType_t tt2,
                                               Args... a) {
-	if (cur_symbol.type == tt1) {
+	if (is(tt1, tt2, a...)) {
 		next_sym();
 		return true;
 	}
-	else {
-		return accept(tt2, a...);
-	}
+	return false;
 }
 
 ALWAYS_INLINE bool nip::parse::Parser::accept(nip::TokenType_t tt) {
@@ -26,14 +24,10 @@ ALWAYS_INLINE bool nip::parse::Parser::accept(nip::TokenType_t tt) {
 	}
 }
 
+// The types make a constant mask, so this is one test however many there are
 template <class... Args>
 ALWAYS_INLINE bool nip::parse::Parser::is(nip::TokenType_t tt1, nip::TokenType_t tt2, Args... a) {
-	if (cur_symbol.type == tt1) {
-		return true;
-	}
-	else {
-		return is(tt2, a...);
-	}
+	return Token_Set_t{tt1, tt2, a...}.contains(cur_symbol.type);
 }
 
 ALWAYS_INLINE bool nip::parse::Parser::is(nip::TokenType_t tt) {
@@ -41,20 +35,26 @@ ALWAYS_INLINE bool nip::parse::Parser::is(nip::TokenType_t tt) {
 }
 
 ALWAYS_INLINE void nip::parse::Parser::next_sym() {
-	last_token_data = (*current).address;
-	if (current != end) {
-		cur_symbol = *++current;
+	last_symbol = cur_symbol;
+	if (lexer) {
+		if (panicking) {
+			return;
+		}
+		if (!lexer->next(cur_symbol)) {
+			cur_symbol = nip::Token_t(NUL);
+		}
+		return;
 	}
-	else {
-		cur_symbol = nip::Token_t(NUL);
+	if (current != end) {
+		++current;
 	}
+	cur_symbol = current != end ? *current : nip::Token_t(NUL);
 }
 
-ALWAYS_INLINE void nip::parse::Parser::error(const char* msg, nip::error::_Error_Type et) {
-	errhdlr.add_error(et, msg, cur_symbol.linenum, cur_symbol.charnum, true);
-	if (et == nip::error::FATAL_ERROR) {
-		throw Parse_Fatal_Error;
-	}
+// Moves the parser to an arbitrary position, making the token there the current symbol
+ALWAYS_INLINE void nip::parse::Parser::seek(nip::Token_Stream::const_iterator pos) {
+	current    = pos;
+	cur_symbol = current != end ? *current : nip::Token_t(NUL);
 }
 
 ALWAYS_INLINE bool nip::parse::Parser::expect(nip::TokenType_t tt, const char* msg,
@@ -66,6 +66,24 @@ ALWAYS_INLINE bool nip::parse::Parser::expect(nip::TokenType_t tt, const char* m
 	return false;
 }
 
+ALWAYS_INLINE uint32_t nip::parse::Parser::current_index() {
+	return static_cast<uint32_t>(current.position());
+}
+
+ALWAYS_INLINE uint32_t nip::parse::Parser::last_index() {
+	return static_cast<uint32_t>(current.position() - 1);
+}
+
+ALWAYS_INLINE void nip::parse::Parser::leaf() {
+	tree->leaf(last_index());
+}
+
+// Whether the statement's line was already used up by a term looking past its end, or by a block
+// that ended in a dedent
+ALWAYS_INLINE bool nip::parse::Parser::line_ended() {
+	return last_symbol.type == NEWLINE || last_symbol.type == DEDENT;
+}
+
 ALWAYS_INLINE void nip::parse::Parser::newlines() {
 	while (accept(NEWLINE))
 		continue;
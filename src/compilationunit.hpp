@@ -0,0 +1,21 @@
+#pragma once
+
+#include "sourcebuffer.hpp"
+#include "token.hpp"
+#include "tokenstream.hpp"
+
+namespace nip {
+	// One program and everything lexed from it: its text, its tokens and the tables the tokens
+	// index into. The compiler owns the unit and the lexer fills it in. Every stage after that
+	// borrows it as a const reference, so nothing made by one stage is copied for the next.
+	// The string table points into the source, so a unit can't be copied or moved.
+	struct Compilation_Unit {
+		Compilation_Unit() = default;
+		Compilation_Unit(const Compilation_Unit&) = delete;
+		Compilation_Unit& operator=(const Compilation_Unit&) = delete;
+
+		Source_Buffer source;
+		Token_Stream tokens;
+		Token_Cache_t caches;
+	};
+}
@@ -3,18 +3,64 @@
 
 #include <chrono>
 #include <iostream>
-#include <tuple>
+
+// Loads the program text, preferring a memory mapping of opt.program_path over streaming the
+// contents of opt.program_stream. Says why on opt.error_stream if it can't.
+bool nip::compiler::open_source() {
+	bool opened = false;
+	if (opt.program_path) {
+		opened = unit.source.open(opt.program_path);
+	}
+	else if (opt.program_stream) {
+		opened = unit.source.read(*opt.program_stream);
+	}
+	if (!opened) {
+		const char* name = opt.program_path ? opt.program_path : "-";
+		if (unit.source.too_large()) {
+			*opt.error_stream << "File " << name << " is 4 GiB or larger, which is too large.\n";
+		}
+		else {
+			*opt.error_stream << "Unable to open file " << name << ".\n";
+		}
+		return false;
+	}
+	errhdlr.set_source(unit.source);
+	if (!unit.source.streaming()) {
+		unit.caches.string.set_source(&unit.source);
+	}
+	return true;
+}
 
 void nip::compiler::compile() {
-	std::vector<nip::Token_t> tokens;
 	std::chrono::nanoseconds time;
-	std::tie(tokens, time) = nip::util::bench_func([&] { return tokenizer(); });
-	*opt.error_stream << "Time to tokenize = " << nip::util::print_time(time) << '\n';
 
-	token_printer(tokens, *opt.output_stream);
+	// A streamed source is lexed as the parser asks for tokens, so there's never a whole token
+	// list to time or print
+	if (unit.source.streaming()) {
+		nip::lex::Lexer lexer(unit.source, unit.caches, errhdlr);
+		time = nip::util::bench_func_void([&] { return parser.parse(lexer, unit.caches); });
+		*opt.error_stream << "Time to lex and parse = " << nip::util::print_time(time) << '\n';
+
+		parser.print_metadata_functor_info();
+		return;
+	}
+
+	time = nip::util::bench_func_void([&] { return tokenizer(); });
+	*opt.error_stream << "Time to tokenize = " << nip::util::print_time(time);
+	if (lex_cache.enabled()) {
+		*opt.error_stream << " (cache: " << lex_cache.hits() << " hit, " << lex_cache.misses()
+		                  << " miss)";
+	}
+	*opt.error_stream << '\n';
+
+	token_printer(unit.tokens, *opt.output_stream);
 
-	time = nip::util::bench_func_void([&] { return parser.parse(tokens, token_caches); });
-	*opt.error_stream << "Time to parse    = " << nip::util::print_time(time) << '\n';
+	time = nip::util::bench_func_void([&] { return parser.parse(unit, syntax_tree); });
+	*opt.error_stream << "Time to parse    = " << nip::util::print_time(time) << " ("
+	                  << syntax_tree.size() << " nodes)\n";
+	if (opt.print_tree && !syntax_tree.empty()) {
+		syntax_tree.print(*opt.output_stream, unit.caches, syntax_tree.root());
+	}
 
 	parser.print_metadata_functor_info();
 }
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace nip {
+	// Index of a constant in its pool
+	using Constant_t = uint32_t;
+
+	// Interns the numeric literals of a program, so each distinct value is stored once and two
+	// constants are equal exactly when their indices are. Values are told apart by their bits,
+	// which keeps 0.0 and -0.0 apart and a NaN equal to itself. Indices are handed out in order of
+	// first appearance and never change, so the values double as the program's constant segment.
+	template <class T>
+	class Constant_Pool {
+		static_assert(sizeof(T) == sizeof(uint64_t) && std::is_trivially_copyable_v<T>,
+		              "constants are hashed as 64 bit words");
+
+	  public:
+		static constexpr Constant_t no_constant = ~Constant_t{0};
+
+		Constant_t intern(T value);
+
+		ALWAYS_INLINE T operator[](Constant_t id) const {
+			return values[id];
+		}
+		size_t size() const {
+			return values.size();
+		}
+
+		// A slot keeps 32 bits of its value's hash, so probing hardly ever has to look at values
+		struct Slot_t {
+			uint32_t tag;
+			Constant_t id = no_constant;
+		};
+
+		// The values in index order and the slots over them, so the pool can be saved as is (see
+		// Lex_Cache). assign() takes both back without hashing anything.
+		const T* data() const {
+			return values.data();
+		}
+		const std::vector<Slot_t>& slot_list() const {
+			return slots;
+		}
+		void assign(const T* first, const T* last, const Slot_t* slot_first, size_t slot_count);
+
+	  private:
+		static uint64_t bits(T value);
+		void rehash(size_t slot_count);
+
+		std::vector<T> values;
+		std::vector<Slot_t> slots; // Open addressed, power of two sized
+	};
+}
+
+#include "constantpool.tpp"
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "util.hpp"
+
+#include <cstring>
+#include <utility>
+
+template <class T>
+ALWAYS_INLINE uint64_t nip::Constant_Pool<T>::bits(T value) {
+	uint64_t b;
+	std::memcpy(&b, &value, sizeof(b));
+	return b;
+}
+
+// The tag is where a slot would be in any table of up to 2^32 slots, so growing only reads the
+// old slots, in order, and writes the new ones in nearly the same order
+template <class T>
+void nip::Constant_Pool<T>::rehash(size_t slot_count) {
+	std::vector<Slot_t> old(slot_count);
+	std::swap(old, slots);
+	size_t mask = slots.size() - 1;
+	for (const Slot_t& s : old) {
+		if (s.id == no_constant) {
+			continue;
+		}
+		size_t i = s.tag & mask;
+		while (slots[i].id != no_constant) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = s;
+	}
+}
+
+template <class T>
+nip::Constant_t nip::Constant_Pool<T>::intern(T value) {
+	// Keep the load factor under a half
+	if ((values.size() + 1) * 2 > slots.size()) {
+		rehash(slots.empty() ? 256 : slots.size() * 2);
+	}
+
+	uint64_t key = bits(value);
+	uint32_t tag = static_cast<uint32_t>(nip::util::hash_mix(key));
+	size_t mask  = slots.size() - 1;
+	size_t i     = tag & mask;
+	for (; slots[i].id != no_constant; i = (i + 1) & mask) {
+		if (slots[i].tag == tag && bits(values[slots[i].id]) == key) {
+			return slots[i].id;
+		}
+	}
+
+	Constant_t id = static_cast<Constant_t>(values.size());
+	values.push_back(value);
+	slots[i] = {tag, id};
+	return id;
+}
+
+template <class T>
+void nip::Constant_Pool<T>::assign(const T* first, const T* last, const Slot_t* slot_first,
+                                   size_t slot_count) {
+	values.assign(first, last);
+	slots.assign(slot_first, slot_first + slot_count);
+}
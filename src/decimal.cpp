@@ -0,0 +1,122 @@
+#include "decimal.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+	constexpr uint32_t powers_of_ten[] = {1,      10,      100,      1000,      10000,
+	                                      100000, 1000000, 10000000, 100000000, 1000000000};
+
+	bool is_digit(char c) {
+		return '0' <= c && c <= '9';
+	}
+
+	// limbs = limbs * factor + addend
+	void multiply_add(std::vector<uint32_t>& limbs, uint32_t factor, uint32_t addend) {
+		uint64_t carry = addend;
+		for (uint32_t& limb : limbs) {
+			uint64_t product = static_cast<uint64_t>(limb) * factor + carry;
+			limb             = static_cast<uint32_t>(product);
+			carry            = product >> 32;
+		}
+		if (carry) {
+			limbs.push_back(static_cast<uint32_t>(carry));
+		}
+	}
+
+	// limbs = limbs / divisor, returning the remainder
+	uint32_t divide(std::vector<uint32_t>& limbs, uint32_t divisor) {
+		uint64_t remainder = 0;
+		for (size_t i = limbs.size(); i-- > 0;) {
+			uint64_t part = remainder << 32 | limbs[i];
+			limbs[i]      = static_cast<uint32_t>(part / divisor);
+			remainder     = part % divisor;
+		}
+		while (!limbs.empty() && limbs.back() == 0) {
+			limbs.pop_back();
+		}
+		return static_cast<uint32_t>(remainder);
+	}
+}
+
+nip::Decimal_t::Decimal_t(const char* first, const char* last) {
+	sign          = first != last && *first == '-';
+	const char* p = first + sign;
+
+	// The digits of the coefficient run up to the exponent, with the point skipped
+	const char* digits_last = p;
+	int64_t fraction        = 0;
+	bool in_fraction        = false;
+	for (; digits_last != last && (is_digit(*digits_last) || *digits_last == '.'); digits_last++) {
+		if (*digits_last == '.') {
+			in_fraction = true;
+		}
+		else {
+			fraction += in_fraction;
+		}
+	}
+	if (digits_last != last && *digits_last == 'e') {
+		const char* e        = digits_last + 1;
+		bool negative_power  = e != last && *e == '-';
+		int64_t power_digits = 0;
+		for (e += negative_power; e != last && is_digit(*e); e++) {
+			if (power_digits < int64_t{1} << 50) {
+				power_digits = power_digits * 10 + (*e - '0');
+			}
+		}
+		power = negative_power ? -power_digits : power_digits;
+	}
+	power -= fraction;
+
+	// Trailing zeros go into the exponent instead
+	const char* significant = digits_last;
+	while (significant != p && (significant[-1] == '0' || significant[-1] == '.')) {
+		significant--;
+		power += significant[0] == '0';
+	}
+
+	// Nine digits at a time, which is as many as fit a limb
+	uint32_t chunk = 0;
+	size_t count   = 0;
+	for (; p != significant; p++) {
+		if (*p == '.') {
+			continue;
+		}
+		chunk = chunk * 10 + (*p - '0');
+		if (++count == 9) {
+			multiply_add(coefficient, powers_of_ten[9], chunk);
+			chunk = count = 0;
+		}
+	}
+	if (count) {
+		multiply_add(coefficient, powers_of_ten[count], chunk);
+	}
+	while (!coefficient.empty() && coefficient.back() == 0) {
+		coefficient.pop_back();
+	}
+	if (coefficient.empty()) {
+		sign  = false;
+		power = 0;
+	}
+}
+
+std::string nip::Decimal_t::to_string() const {
+	// Nine digits at a time off the bottom, so they come out in reverse
+	std::vector<uint32_t> rest = coefficient;
+	std::string digits;
+	do {
+		uint32_t chunk = divide(rest, powers_of_ten[9]);
+		for (size_t i = 0; i < 9 && (chunk || !rest.empty() || i == 0); i++) {
+			digits += static_cast<char>('0' + chunk % 10);
+			chunk /= 10;
+		}
+	} while (!rest.empty());
+	if (sign) {
+		digits += '-';
+	}
+	std::reverse(digits.begin(), digits.end());
+	if (power != 0) {
+		digits += 'e' + std::to_string(power);
+	}
+	return digits;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nip {
+	// A numeric literal held exactly, for the few that don't fit an int64_t or a double without
+	// losing something. The value is coefficient * 10^exponent, where the coefficient is an
+	// unsigned integer of any size, kept as 32 bit limbs with the least significant first. Trailing
+	// zeros are moved into the exponent, so equal values are equal field by field.
+	class Decimal_t {
+	  public:
+		Decimal_t() = default;
+		// Parses a literal the way the lexer reads one: an optional -, digits, and then optionally
+		// a fraction and an exponent. An exponent past 2^50 is clamped there.
+		Decimal_t(const char* first, const char* last);
+		Decimal_t(bool negative, int64_t exponent, std::vector<uint32_t> limbs)
+		    : sign(negative), power(exponent), coefficient(std::move(limbs)){};
+
+		bool negative() const {
+			return sign;
+		}
+		int64_t exponent() const {
+			return power;
+		}
+		const std::vector<uint32_t>& limbs() const {
+			return coefficient;
+		}
+
+		// The coefficient's digits, followed by e and the exponent unless it is zero
+		std::string to_string() const;
+
+		bool operator==(const Decimal_t& rhs) const {
+			return sign == rhs.sign && power == rhs.power && coefficient == rhs.coefficient;
+		}
+		bool operator!=(const Decimal_t& rhs) const {
+			return !(*this == rhs);
+		}
+
+	  private:
+		bool sign     = false;
+		int64_t power = 0;
+		std::vector<uint32_t> coefficient; // Empty for zero
+	};
+}
@@ -0,0 +1,430 @@
+#include "lexcache.hpp"
+#include "Lexer/lexer.hpp"
+#include "util.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIP_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// Bump when the layout below changes
+	constexpr uint32_t format_version = 4;
+	constexpr char magic[4]           = {'n', 'i', 'p', 't'};
+
+	// Every array is stored in this order, each starting on an 8 byte boundary
+	struct Header_t {
+		char magic[4];
+		uint32_t version;
+		uint64_t source_hash;
+		uint64_t source_size;
+		uint64_t tokens;
+		uint64_t integers;
+		uint64_t integer_slots;
+		uint64_t floats;
+		uint64_t float_slots;
+		uint64_t symbol_chars;
+		uint64_t symbols;
+		uint64_t symbol_slots;
+		uint64_t string_chars;
+		uint64_t strings;
+		uint64_t decimals;
+		uint64_t decimal_limbs;
+		uint64_t lines;
+		uint64_t errors;
+		uint64_t error_chars;
+	};
+
+	struct Decimal_Record_t {
+		int64_t exponent;
+		uint32_t limbs;
+		uint8_t negative;
+	};
+
+	struct Error_Record_t {
+		uint64_t offset;
+		uint32_t msg_length;
+		uint8_t type;
+		uint8_t has_location;
+	};
+
+	std::string unique_suffix() {
+#ifdef NIP_HAS_MMAP
+		return std::to_string(::getpid());
+#else
+		return std::string();
+#endif
+	}
+
+	uint32_t entry_version() {
+		return format_version << 16 | nip::lex::lexer_version;
+	}
+
+	size_t padded(size_t bytes) {
+		return (bytes + 7) & ~size_t{7};
+	}
+
+	// Whether length chars starting at offset lie within the first limit
+	bool fits(uint64_t offset, uint64_t length, uint64_t limit) {
+		return offset <= limit && length <= limit - offset;
+	}
+
+	// Whether slot_count slots can be probed for count entries: a power of two, kept under half
+	// full, so probing always reaches an empty slot
+	bool table_fits(uint64_t slot_count, uint64_t count) {
+		return (slot_count & (slot_count - 1)) == 0 && count <= slot_count / 2;
+	}
+
+	template <class T>
+	bool pool_slots_fit(const typename nip::Constant_Pool<T>::Slot_t* slots, uint64_t slot_count,
+	                    uint64_t count) {
+		bool valid = table_fits(slot_count, count);
+		for (size_t i = 0; i < slot_count; i++) {
+			valid &= slots[i].id == nip::Constant_Pool<T>::no_constant || slots[i].id < count;
+		}
+		return valid;
+	}
+
+	// How many entries the table a token of type t points into has, or its payload's limit if
+	// it isn't an address
+	uint64_t payload_limit(nip::TokenType_t t, const Header_t& h) {
+		switch (t) {
+			case nip::IDENTIFIER:
+				return h.symbols;
+			case nip::LIT_INT:
+				return h.integers;
+			case nip::LIT_FLOAT:
+				return h.floats;
+			case nip::LIT_DECIMAL:
+				return h.decimals;
+			case nip::LIT_STRING:
+				return h.strings;
+			default:
+				return uint64_t{1} << 32;
+		}
+	}
+
+	class Writer_t {
+	  public:
+		void append(const void* p, size_t bytes) {
+			size_t at = buffer.size();
+			buffer.resize(at + padded(bytes));
+			if (bytes) {
+				std::memcpy(buffer.data() + at, p, bytes);
+			}
+		}
+		const std::vector<char>& data() const {
+			return buffer;
+		}
+
+	  private:
+		std::vector<char> buffer;
+	};
+
+	// Walks the arrays of an entry in place, refusing to step past the end of it
+	class Reader_t {
+	  public:
+		Reader_t(const char* p, size_t bytes) : cur(p), end(p + bytes){};
+
+		template <class T>
+		const T* take(size_t count) {
+			// A damaged count could wrap the multiplication, so it is checked before it
+			if (count > size_t(end - cur) / sizeof(T)) {
+				failed = true;
+				return nullptr;
+			}
+			size_t bytes = padded(count * sizeof(T));
+			if (size_t(end - cur) < bytes) {
+				failed = true;
+				return nullptr;
+			}
+			const T* p = reinterpret_cast<const T*>(cur);
+			cur += bytes;
+			return p;
+		}
+		bool ok() const {
+			return !failed && cur == end;
+		}
+
+	  private:
+		const char* cur;
+		const char* end;
+		bool failed = false;
+	};
+
+	// A whole entry in memory: mapped where possible, read in otherwise
+	class Entry_File_t {
+	  public:
+		explicit Entry_File_t(const std::string& path) {
+#ifdef NIP_HAS_MMAP
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return;
+			}
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0) {
+				void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (m != MAP_FAILED) {
+					mapping = m;
+					bytes   = st.st_size;
+				}
+			}
+			::close(fd);
+#else
+			std::ifstream in(path, std::ios::binary);
+			owned.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			bytes = owned.size();
+#endif
+		}
+		~Entry_File_t() {
+#ifdef NIP_HAS_MMAP
+			if (mapping) {
+				munmap(mapping, bytes);
+			}
+#endif
+		}
+		Entry_File_t(const Entry_File_t&) = delete;
+		Entry_File_t& operator=(const Entry_File_t&) = delete;
+
+		const char* data() const {
+#ifdef NIP_HAS_MMAP
+			return static_cast<const char*>(mapping);
+#else
+			return owned.data();
+#endif
+		}
+		size_t size() const {
+			return bytes;
+		}
+
+	  private:
+#ifdef NIP_HAS_MMAP
+		void* mapping = nullptr;
+#else
+		std::vector<char> owned;
+#endif
+		size_t bytes = 0;
+	};
+}
+
+nip::Lex_Cache::Lex_Cache(const char* dir) : directory(dir ? dir : "") {
+#ifdef NIP_HAS_MMAP
+	if (enabled()) {
+		::mkdir(directory.c_str(), 0777);
+	}
+#endif
+}
+
+uint64_t nip::Lex_Cache::key(const nip::Source_Buffer& source) const {
+	return nip::util::hash_bytes(source.begin(), source.size(), entry_version());
+}
+
+std::string nip::Lex_Cache::entry_path(uint64_t key) const {
+	char name[32];
+	std::snprintf(name, sizeof(name), "/%016llx.tok", static_cast<unsigned long long>(key));
+	return directory + name;
+}
+
+bool nip::Lex_Cache::load(uint64_t key, nip::Source_Buffer& source, nip::Token_Stream& tokens,
+                          nip::Token_Cache_t& token_caches, nip::error::Error_Handler& errhdlr) {
+	if (!enabled()) {
+		return false;
+	}
+	Entry_File_t file(entry_path(key));
+	if (file.size() < sizeof(Header_t)) {
+		miss_count++;
+		return false;
+	}
+
+	Reader_t in(file.data(), file.size());
+	const Header_t& h = *in.take<Header_t>(1);
+	if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != entry_version() ||
+	    h.source_hash != key || h.source_size != source.size()) {
+		miss_count++;
+		return false;
+	}
+	auto types         = in.take<uint8_t>(h.tokens);
+	auto payloads      = in.take<uint32_t>(h.tokens);
+	auto offsets       = in.take<uint32_t>(h.tokens);
+	auto integers      = in.take<int64_t>(h.integers);
+	auto integer_slots = in.take<nip::Constant_Pool<int64_t>::Slot_t>(h.integer_slots);
+	auto floats        = in.take<double>(h.floats);
+	auto float_slots   = in.take<nip::Constant_Pool<double>::Slot_t>(h.float_slots);
+	auto symbol_chars  = in.take<char>(h.symbol_chars);
+	auto symbols       = in.take<nip::Symbol_Table::Entry_t>(h.symbols);
+	auto symbol_slots  = in.take<nip::Symbol_t>(h.symbol_slots);
+	auto string_chars  = in.take<char>(h.string_chars);
+	auto strings       = in.take<nip::Literal_Table::Entry_t>(h.strings);
+	auto decimals      = in.take<Decimal_Record_t>(h.decimals);
+	auto limbs         = in.take<uint32_t>(h.decimal_limbs);
+	auto lines         = in.take<uint32_t>(h.lines);
+	auto errors        = in.take<Error_Record_t>(h.errors);
+	auto error_chars   = in.take<char>(h.error_chars);
+	if (!in.ok()) {
+		miss_count++;
+		return false;
+	}
+
+	// The sections are the sizes the header says, but what is in them has to agree with it too
+	// before anything is read through them. Anything that doesn't is a miss like any other.
+	bool valid = true;
+	for (size_t i = 0; i < h.tokens; i++) {
+		valid &= types[i] <= nip::KEY_WITH && offsets[i] <= h.source_size &&
+		         payloads[i] < payload_limit(static_cast<nip::TokenType_t>(types[i]), h);
+	}
+	for (size_t i = 0; i < h.symbols; i++) {
+		valid &= fits(symbols[i].offset, symbols[i].length, h.symbol_chars);
+	}
+	valid &= table_fits(h.symbol_slots, h.symbols);
+	for (size_t i = 0; i < h.symbol_slots; i++) {
+		valid &= symbol_slots[i] == nip::Symbol_Table::no_symbol || symbol_slots[i] < h.symbols;
+	}
+	valid &= pool_slots_fit<int64_t>(integer_slots, h.integer_slots, h.integers);
+	valid &= pool_slots_fit<double>(float_slots, h.float_slots, h.floats);
+	for (size_t i = 0; i < h.strings; i++) {
+		const nip::Literal_Table::Entry_t& e = strings[i];
+		bool decoded = e.length & nip::Literal_Table::in_arena;
+		valid &= fits(e.offset, e.length & ~nip::Literal_Table::in_arena,
+		              decoded ? h.string_chars : h.source_size);
+	}
+	uint64_t limb_total = 0;
+	for (size_t i = 0; i < h.decimals; i++) {
+		limb_total += decimals[i].limbs;
+	}
+	for (size_t i = 0; i < h.lines; i++) {
+		valid &= lines[i] <= h.source_size;
+	}
+	uint64_t error_total = 0;
+	for (size_t i = 0; i < h.errors; i++) {
+		error_total += errors[i].msg_length;
+		valid &= errors[i].offset <= h.source_size;
+	}
+	if (!valid || limb_total != h.decimal_limbs || error_total != h.error_chars) {
+		miss_count++;
+		return false;
+	}
+
+	tokens.assign(types, payloads, offsets, h.tokens);
+	token_caches.integer.assign(integers, integers + h.integers, integer_slots, h.integer_slots);
+	token_caches.floating_pt.assign(floats, floats + h.floats, float_slots, h.float_slots);
+	token_caches.identifier.assign(std::string_view(symbol_chars, h.symbol_chars), symbols,
+	                               h.symbols, symbol_slots, h.symbol_slots);
+	token_caches.string.assign(std::string_view(string_chars, h.string_chars), strings, h.strings);
+	for (size_t i = 0; i < h.decimals; i++) {
+		const Decimal_Record_t& d = decimals[i];
+		token_caches.decimal.emplace_back(d.negative, d.exponent,
+		                                  std::vector<uint32_t>(limbs, limbs + d.limbs));
+		limbs += d.limbs;
+	}
+	source.adopt_line_index(lines, lines + h.lines);
+	for (size_t i = 0; i < h.errors; i++) {
+		const Error_Record_t& e = errors[i];
+		std::string msg(error_chars, e.msg_length);
+		error_chars += e.msg_length;
+		errhdlr.add_error(static_cast<nip::error::_Error_Type>(e.type), msg, e.offset,
+		                  e.has_location);
+	}
+	hit_count++;
+	return true;
+}
+
+void nip::Lex_Cache::store(uint64_t key, const nip::Source_Buffer& source,
+                           const nip::Token_Stream& tokens, const nip::Token_Cache_t& token_caches,
+                           const nip::error::Error_Handler& errhdlr) {
+	if (!enabled()) {
+		return;
+	}
+	const auto& symbols = token_caches.identifier.entry_list();
+	const auto& strings = token_caches.string.entry_list();
+	const auto& lines   = source.line_index();
+	// The records are value initialized and filled in place, so their padding is zeros rather
+	// than whatever was in memory, and the same source always writes the same entry
+	std::vector<Decimal_Record_t> decimals(token_caches.decimal.size());
+	std::vector<uint32_t> limbs;
+	for (size_t i = 0; i < decimals.size(); i++) {
+		const nip::Decimal_t& d = token_caches.decimal[i];
+		decimals[i].exponent    = d.exponent();
+		decimals[i].limbs       = static_cast<uint32_t>(d.limbs().size());
+		decimals[i].negative    = d.negative();
+		limbs.insert(limbs.end(), d.limbs().begin(), d.limbs().end());
+	}
+	std::vector<Error_Record_t> errors(errhdlr.size());
+	std::string error_chars;
+	for (size_t i = 0; i < errors.size(); i++) {
+		const nip::error::_Error& e = errhdlr.errors()[i];
+		errors[i].offset            = e.offset;
+		errors[i].msg_length        = static_cast<uint32_t>(e.msg.size());
+		errors[i].type              = static_cast<uint8_t>(e.type);
+		errors[i].has_location      = e.has_location;
+		error_chars += e.msg;
+	}
+
+	Header_t h{};
+	std::memcpy(h.magic, magic, sizeof(magic));
+	h.version       = entry_version();
+	h.source_hash   = key;
+	h.source_size   = source.size();
+	h.tokens        = tokens.size();
+	h.integers      = token_caches.integer.size();
+	h.integer_slots = token_caches.integer.slot_list().size();
+	h.floats        = token_caches.floating_pt.size();
+	h.float_slots   = token_caches.floating_pt.slot_list().size();
+	h.symbol_chars  = token_caches.identifier.text().size();
+	h.symbols       = symbols.size();
+	h.symbol_slots  = token_caches.identifier.slot_list().size();
+	h.string_chars  = token_caches.string.text().size();
+	h.strings       = strings.size();
+	h.decimals      = decimals.size();
+	h.decimal_limbs = limbs.size();
+	h.lines         = lines.size();
+	h.errors        = errors.size();
+	h.error_chars   = error_chars.size();
+
+	Writer_t out;
+	out.append(&h, sizeof(h));
+	out.append(tokens.type_data(), h.tokens * sizeof(uint8_t));
+	out.append(tokens.payload_data(), h.tokens * sizeof(uint32_t));
+	out.append(tokens.offset_data(), h.tokens * sizeof(uint32_t));
+	out.append(token_caches.integer.data(), h.integers * sizeof(int64_t));
+	out.append(token_caches.integer.slot_list().data(),
+	           h.integer_slots * sizeof(nip::Constant_Pool<int64_t>::Slot_t));
+	out.append(token_caches.floating_pt.data(), h.floats * sizeof(double));
+	out.append(token_caches.floating_pt.slot_list().data(),
+	           h.float_slots * sizeof(nip::Constant_Pool<double>::Slot_t));
+	out.append(token_caches.identifier.text().data(), h.symbol_chars);
+	out.append(symbols.data(), h.symbols * sizeof(symbols[0]));
+	out.append(token_caches.identifier.slot_list().data(), h.symbol_slots * sizeof(nip::Symbol_t));
+	out.append(token_caches.string.text().data(), h.string_chars);
+	out.append(strings.data(), h.strings * sizeof(strings[0]));
+	out.append(decimals.data(), h.decimals * sizeof(Decimal_Record_t));
+	out.append(limbs.data(), h.decimal_limbs * sizeof(uint32_t));
+	out.append(lines.data(), h.lines * sizeof(uint32_t));
+	out.append(errors.data(), h.errors * sizeof(Error_Record_t));
+	out.append(error_chars.data(), h.error_chars);
+
+	// Written to the side and renamed into place, so a concurrent build never sees half an entry
+	std::string path = entry_path(key);
+	std::string temp = path + ".tmp" + unique_suffix();
+	{
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+		file.write(out.data().data(), out.data().size());
+		if (!file) {
+			std::remove(temp.c_str());
+			return;
+		}
+	}
+	if (std::rename(temp.c_str(), path.c_str()) != 0) {
+		std::remove(temp.c_str());
+	}
+}
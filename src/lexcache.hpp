@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Error/errorhandler.hpp"
+#include "sourcebuffer.hpp"
+#include "token.hpp"
+#include "tokenstream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nip {
+	// Keeps lexed sources in a directory between runs, so files that haven't changed aren't
+	// lexed again. An entry holds the token stream, the literal caches along with their hash
+	// slots, the line index and the lexer's errors as flat arrays, and is named after a hash of
+	// the source bytes and the lexer version. Loading one maps the file and copies the arrays
+	// straight out of it, with nothing to parse or hash. They are copied rather than used in
+	// place because the stream and tables keep growing after the lexer is done with them, and
+	// the mapping is closed once the load is over.
+	//
+	// Entries are only meaningful to the machine and build that wrote them. Anything that doesn't
+	// check out is treated as a miss and overwritten.
+	class Lex_Cache {
+	  public:
+		// A null or empty directory disables the cache
+		explicit Lex_Cache(const char* dir);
+
+		bool enabled() const {
+			return !directory.empty();
+		}
+
+		// Names the entry for source, hashing all of it
+		uint64_t key(const nip::Source_Buffer& source) const;
+
+		// Fills in everything the lexer would have for source, returning false on a miss.
+		// token_caches and errhdlr must not have anything in them yet.
+		bool load(uint64_t key, nip::Source_Buffer& source, nip::Token_Stream& tokens,
+		          nip::Token_Cache_t& token_caches, nip::error::Error_Handler& errhdlr);
+		// Saves what the lexer produced for source. Failing to is not an error, the next run just
+		// lexes again.
+		void store(uint64_t key, const nip::Source_Buffer& source, const nip::Token_Stream& tokens,
+		           const nip::Token_Cache_t& token_caches,
+		           const nip::error::Error_Handler& errhdlr);
+
+		size_t hits() const {
+			return hit_count;
+		}
+		size_t misses() const {
+			return miss_count;
+		}
+
+	  private:
+		std::string entry_path(uint64_t key) const;
+
+		std::string directory;
+		size_t hit_count  = 0;
+		size_t miss_count = 0;
+	};
+}
@@ -0,0 +1,22 @@
+#include "literaltable.hpp"
+
+nip::Literal_t nip::Literal_Table::append(const Literal_Table& from, size_t count) {
+	Literal_t first = static_cast<Literal_t>(entries.size());
+	size_t base     = arena.size();
+	size_t used     = 0;
+	for (size_t i = 0; i < count; i++) {
+		Entry_t e = from.entries[i];
+		if (e.length & in_arena) {
+			used = e.offset + (e.length & ~in_arena);
+			e.offset += static_cast<uint32_t>(base);
+		}
+		entries.push_back(e);
+	}
+	arena.append(from.arena, 0, used);
+	return first;
+}
+
+void nip::Literal_Table::assign(std::string_view text, const Entry_t* first, size_t count) {
+	arena.assign(text.data(), text.size());
+	entries.assign(first, first + count);
+}
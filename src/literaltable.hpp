@@ -0,0 +1,88 @@
+#pragma once
+
+#include "sourcebuffer.hpp"
+#include "utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nip {
+	// Index of a string literal, in order of appearance
+	using Literal_t = uint32_t;
+
+	// The text of every string literal. One written without escapes is its own text, so it is
+	// only a view of the source. The rest are decoded into an arena, which only ever grows at the
+	// end, so a literal is written straight into place as it is decoded.
+	//
+	// Views are only kept while a source is set, and only make sense for a source that is mapped
+	// whole and never edited. Without one every literal is decoded.
+	class Literal_Table {
+	  public:
+		struct Entry_t {
+			uint32_t offset; // Into the source, or into text() for a decoded literal
+			uint32_t length; // Has in_arena set for a decoded literal
+		};
+		static constexpr uint32_t in_arena     = uint32_t{1} << 31;
+		static constexpr Literal_t no_literal = ~Literal_t{0};
+
+		void set_source(const nip::Source_Buffer* s) {
+			source_file = s;
+		}
+		const nip::Source_Buffer* source() const {
+			return source_file;
+		}
+
+		ALWAYS_INLINE std::string_view operator[](Literal_t id) const {
+			const Entry_t& e = entries[id];
+			const char* text = e.length & in_arena ? arena.data() + e.offset
+			                                        : source_file->at(e.offset);
+			return std::string_view(text, e.length & ~in_arena);
+		}
+		size_t size() const {
+			return entries.size();
+		}
+
+		Literal_t view(size_t offset, size_t length) {
+			entries.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+			return static_cast<Literal_t>(entries.size() - 1);
+		}
+
+		// A decoded literal is opened, written a piece at a time and closed, which gives its id
+		ALWAYS_INLINE void open() {
+			opened = arena.size();
+		}
+		ALWAYS_INLINE void put(char c) {
+			arena.push_back(c);
+		}
+		ALWAYS_INLINE void put(std::string_view s) {
+			arena.append(s.data(), s.size());
+		}
+		Literal_t close() {
+			entries.push_back({static_cast<uint32_t>(opened),
+			                   static_cast<uint32_t>(arena.size() - opened) | in_arena});
+			return static_cast<Literal_t>(entries.size() - 1);
+		}
+
+		// Adds the first count literals of from, which must have the same source, and returns
+		// the id the first of them gets
+		Literal_t append(const Literal_Table& from, size_t count);
+
+		// The table as two flat arrays, so it can be saved as is (see Lex_Cache)
+		std::string_view text() const {
+			return arena;
+		}
+		const std::vector<Entry_t>& entry_list() const {
+			return entries;
+		}
+		void assign(std::string_view text, const Entry_t* first, size_t count);
+
+	  private:
+		const nip::Source_Buffer* source_file = nullptr;
+		std::string arena;
+		std::vector<Entry_t> entries;
+		size_t opened = 0;
+	};
+}
@@ -1,27 +1,45 @@
 #include "nip.hpp"
 #include "options.hpp"
 
-#include <fstream>
 #include <iostream>
+#include <string>
 
 int main(int argc, char* argv[]) {
-	if (argc != 2) {
+	nip::Options opt;
+	const char* program = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (argv[i] == std::string("--cache") && i + 1 < argc) {
+			opt.cache_dir = argv[++i];
+		}
+		else if (argv[i] == std::string("--ast")) {
+			opt.print_tree = true;
+		}
+		else if (!program) {
+			program = argv[i];
+		}
+		else {
+			program = nullptr;
+			break;
+		}
+	}
+	if (!program) {
 		std::cerr << "Invalid amount of arguments.\n";
 		return 1;
 	}
 
-	std::ifstream in_file(argv[1]);
-	if (!in_file) {
-		std::cerr << "Unable to open file " << argv[1] << ".\n";
-		return 1;
+	// "-" reads the program from stdin
+	if (program == std::string("-")) {
+		opt.program_stream = &std::cin;
 	}
-
-	nip::Options opt;
-
-	opt.program_stream = &in_file;
-	opt.output_stream  = &std::cout;
-	opt.error_stream   = &std::cerr;
+	else {
+		opt.program_path = program;
+	}
+	opt.output_stream = &std::cout;
+	opt.error_stream  = &std::cerr;
 
 	nip::compiler comp(opt);
+	if (!comp.open_source()) {
+		return 1;
+	}
 	comp.compile();
 }
@@ -1,9 +1,11 @@
 #pragma once
 
+#include "AST/syntaxtree.hpp"
 #include "Error/errorhandler.hpp"
 #include "Parser/parser.hpp"
+#include "compilationunit.hpp"
+#include "lexcache.hpp"
 #include "options.hpp"
-#include "token.hpp"
 
 #include <iosfwd>
 #include <vector>
@@ -11,19 +13,24 @@
 namespace nip {
 	class compiler {
 	  private:
-		Token_Cache_t token_caches;
+		nip::Compilation_Unit unit;
+		nip::ast::Syntax_Tree syntax_tree;
 
 		nip::Options opt;
 		nip::error::Error_Handler errhdlr;
+		nip::Lex_Cache lex_cache;
 
 		nip::parse::Parser parser;
 
-		std::vector<nip::Token_t> tokenizer();
-		void token_printer(std::vector<nip::Token_t>&, std::ostream&);
+		// Lexes unit.source into unit.tokens
+		void tokenizer();
+		void token_printer(const Token_Stream&, std::ostream&);
 
 	  public:
-		compiler(nip::Options& o) : opt(o), parser(errhdlr, opt, *opt.error_stream){};
+		compiler(nip::Options& o)
+		    : opt(o), lex_cache(opt.cache_dir), parser(errhdlr, opt, *opt.error_stream){};
 		void argument_parser(int argc, char* argv[]);
+		bool open_source();
 		void compile();
 	};
 }
@@ -4,8 +4,14 @@
 
 namespace nip {
 	struct Options {
+		const char* program_path     = nullptr;
 		std::istream* program_stream = nullptr;
 		std::ostream* output_stream  = &std::cout;
 		std::ostream* error_stream   = &std::cerr;
+		size_t lex_threads           = 0;       // 0 uses every core
+		size_t parse_threads         = 0;       // 0 uses every core
+		size_t error_limit           = 20;      // Errors a parse reports before it gives up
+		const char* cache_dir        = nullptr; // Keeps lexed files between runs, see Lex_Cache
+		bool print_tree              = false;   // Prints the syntax tree after the tokens
 	};
 }
\ No newline at end of file
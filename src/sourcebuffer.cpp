@@ -0,0 +1,229 @@
+#include "sourcebuffer.hpp"
+#include "Lexer/scan.hpp"
+#include "Lexer/utf8.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <istream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIP_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace {
+	constexpr size_t stream_chunk = 1 << 16;
+}
+
+nip::Source_Buffer::~Source_Buffer() {
+	release();
+}
+
+void nip::Source_Buffer::release() {
+#ifdef NIP_HAS_MMAP
+	if (mapping) {
+		munmap(mapping, mapping_length);
+	}
+	if (stream_fd >= 0) {
+		::close(stream_fd);
+	}
+#endif
+	mapping        = nullptr;
+	mapping_length = 0;
+	owned.clear();
+	stream_fd     = -1;
+	stream_in     = nullptr;
+	stream_done   = false;
+	oversized     = false;
+	window_offset = 0;
+	line_starts.clear();
+	indexed = 0;
+	data    = "";
+	length  = 0;
+}
+
+bool nip::Source_Buffer::open(const char* path) {
+	release();
+#ifdef NIP_HAS_MMAP
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+	if (regular && uint64_t(st.st_size) > max_size) {
+		::close(fd);
+		oversized = true;
+		return false;
+	}
+	if (regular && st.st_size > 0) {
+		void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (m != MAP_FAILED) {
+			madvise(m, st.st_size, MADV_SEQUENTIAL);
+			::close(fd);
+			mapping        = m;
+			mapping_length = st.st_size;
+			data           = static_cast<const char*>(m);
+			length         = st.st_size;
+			return true;
+		}
+	}
+
+	// Not mappable, so stream it
+	stream_fd = fd;
+	return true;
+#else
+	// Without mmap the whole file is read up front
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+	owned.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	if (owned.size() > max_size) {
+		owned.clear();
+		oversized = true;
+		return false;
+	}
+	data   = owned.empty() ? "" : owned.data();
+	length = owned.size();
+	return !in.bad();
+#endif
+}
+
+bool nip::Source_Buffer::read(std::istream& in) {
+	release();
+	stream_in = &in;
+	return !in.bad();
+}
+
+void nip::Source_Buffer::assign(std::string_view text) {
+	release();
+	owned.assign(text.begin(), text.end());
+	data   = owned.empty() ? "" : owned.data();
+	length = owned.size();
+}
+
+void nip::Source_Buffer::edit(size_t offset, size_t count, std::string_view text) {
+	if (mapping) {
+		owned.assign(data, data + length);
+#ifdef NIP_HAS_MMAP
+		munmap(mapping, mapping_length);
+#endif
+		mapping        = nullptr;
+		mapping_length = 0;
+	}
+	nip::util::replace_range(owned, offset, count, text.begin(), text.end());
+	line_starts.clear();
+	indexed = 0;
+	data    = owned.empty() ? "" : owned.data();
+	length  = owned.size();
+}
+
+size_t nip::Source_Buffer::read_more(char* out, size_t count) {
+#ifdef NIP_HAS_MMAP
+	if (stream_fd >= 0) {
+		ssize_t got;
+		do {
+			got = ::read(stream_fd, out, count);
+		} while (got < 0 && errno == EINTR);
+		return got > 0 ? got : 0;
+	}
+#endif
+	stream_in->read(out, count);
+	return stream_in->gcount();
+}
+
+bool nip::Source_Buffer::refill(const char* keep) {
+	if (!streaming()) {
+		return false;
+	}
+
+	// Drop what the lexer is done with, including any partial line read past the window. Its
+	// lines are counted first, since they can't be found again later.
+	index_lines();
+	size_t drop = keep - data;
+	window_offset += drop;
+	owned.erase(owned.begin(), owned.begin() + drop);
+	size_t exposed = length - drop;
+
+	// Read until the window ends on a newline again, or the input runs out
+	size_t scanned = exposed;
+	while (true) {
+		auto last_newline = std::find(owned.rbegin(), owned.rend() - scanned, '\n');
+		if (last_newline != owned.rend() - scanned) {
+			exposed = owned.rend() - last_newline;
+			break;
+		}
+		scanned = owned.size();
+		if (stream_done) {
+			exposed = owned.size();
+			break;
+		}
+		owned.resize(owned.size() + stream_chunk);
+		size_t got = read_more(owned.data() + scanned, stream_chunk);
+		owned.resize(scanned + got);
+		stream_done = got == 0;
+		// Anything past max_size couldn't be given an offset, so the input ends there
+		if (window_offset + owned.size() > max_size) {
+			owned.resize(max_size - window_offset);
+			oversized   = true;
+			stream_done = true;
+		}
+	}
+
+	data   = owned.empty() ? "" : owned.data();
+	length = exposed;
+	return length != 0;
+}
+
+void nip::Source_Buffer::index_lines() const {
+	if (line_starts.empty()) {
+		line_starts.push_back(0);
+	}
+	size_t window_end = window_offset + length;
+	if (indexed < window_end) {
+		nip::scan::kernels().line_starts(data + (indexed - window_offset), data + length,
+		                                 static_cast<uint32_t>(indexed), line_starts);
+		indexed = window_end;
+	}
+}
+
+nip::Source_Location_t nip::Source_Buffer::locate(size_t offset) const {
+	index_lines();
+	size_t line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) -
+	              line_starts.begin();
+	size_t first = line_starts[line - 1];
+	if (first < window_offset || offset > window_offset + length) {
+		return {line, offset - first + 1};
+	}
+	return {line, nip::utf8::code_points(at(first), at(offset)) + 1};
+}
+
+std::string_view nip::Source_Buffer::line(size_t linenum) const {
+	index_lines();
+	if (linenum == 0 || linenum > line_starts.size() || line_starts[linenum - 1] < window_offset) {
+		return std::string_view();
+	}
+	size_t first = line_starts[linenum - 1] - window_offset;
+	size_t last  = linenum < line_starts.size() ? line_starts[linenum] - 1 - window_offset : length;
+	return std::string_view(data + first, last - first);
+}
+
+const std::vector<uint32_t>& nip::Source_Buffer::line_index() const {
+	index_lines();
+	return line_starts;
+}
+
+void nip::Source_Buffer::adopt_line_index(const uint32_t* first, const uint32_t* last) {
+	line_starts.assign(first, last);
+	indexed = window_offset + length;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+namespace nip {
+	// 1-based, like editors show them
+	struct Source_Location_t {
+		size_t line;
+		size_t column;
+	};
+
+	// Holds the program text as one contiguous, read-only block of bytes. Regular files are
+	// memory mapped so the lexer and the error handler share a single copy of the source.
+	//
+	// Inputs that can't be mapped (pipes, stdin) are streamed instead: only a window of the
+	// input is in memory, and it always ends on a line boundary (or the end of the input). When
+	// the lexer runs off the end of the window it calls refill(), which throws away everything
+	// it has consumed and reads the next lines, so memory stays bounded by the longest line or
+	// multi-line token rather than the whole file.
+	//
+	// Positions are byte offsets from the start of the input, kept in 32 bits, so an input has to
+	// be smaller than 4 GiB. A larger file fails to open, and a larger stream stops at the limit
+	// with too_large() set. Lines are only counted when a diagnostic asks for one: the first call
+	// to locate() or line() finds every line start with a vectorized scan. A streamed input has
+	// its line starts saved as each window is dropped.
+	class Source_Buffer {
+	  public:
+		Source_Buffer() = default;
+		~Source_Buffer();
+		Source_Buffer(const Source_Buffer&) = delete;
+		Source_Buffer& operator=(const Source_Buffer&) = delete;
+
+		static constexpr size_t max_size = UINT32_MAX;
+
+		bool open(const char* path);
+		bool read(std::istream& in);
+		// Whether the input was cut off, or not opened, for being larger than max_size
+		bool too_large() const {
+			return oversized;
+		}
+		void assign(std::string_view text);
+
+		// Replaces count bytes at offset with text. A mapped file is copied into memory first,
+		// since the mapping is read only. Streamed sources can't be edited.
+		void edit(size_t offset, size_t count, std::string_view text);
+
+		const char* begin() const {
+			return data;
+		}
+		const char* end() const {
+			return data + length;
+		}
+		size_t size() const {
+			return length;
+		}
+		// Offset from the start of the input of p, which must point into the window
+		size_t offset(const char* p) const {
+			return window_offset + (p - data);
+		}
+		// Where an offset inside the window is
+		const char* at(size_t offset) const {
+			return data + (offset - window_offset);
+		}
+
+		bool streaming() const {
+			return stream_fd >= 0 || stream_in;
+		}
+		// Drops the window up to keep, which must point into it, and reads more input. Returns
+		// false once nothing is left past keep. Invalidates every pointer into the old window.
+		bool refill(const char* keep);
+
+		// The line and column of a byte offset. Columns count characters, not bytes, unless the
+		// start of the line was already dropped from a streamed input.
+		Source_Location_t locate(size_t offset) const;
+		// Returns the text of a 1-based line number without its newline. Lines that a streamed
+		// input has already dropped come back empty.
+		std::string_view line(size_t linenum) const;
+
+		// Every line start, found all at once, for saving along with the tokens (see Lex_Cache).
+		// adopt_line_index() takes them back for the same text so they aren't searched for again.
+		const std::vector<uint32_t>& line_index() const;
+		void adopt_line_index(const uint32_t* first, const uint32_t* last);
+
+	  private:
+		void release();
+		size_t read_more(char* out, size_t count);
+		void index_lines() const;
+
+		const char* data = "";
+		size_t length    = 0;
+
+		void* mapping         = nullptr;
+		size_t mapping_length = 0;
+		std::vector<char> owned;
+
+		int stream_fd           = -1;
+		std::istream* stream_in = nullptr;
+		bool stream_done        = false;
+		bool oversized          = false;
+		size_t window_offset    = 0; // Offset of the window's first byte
+
+		// Offset of every line start up to indexed
+		mutable std::vector<uint32_t> line_starts;
+		mutable size_t indexed = 0;
+	};
+}
@@ -0,0 +1,81 @@
+#include "symboltable.hpp"
+#include "util.hpp"
+
+// Finds the slot holding name, or the empty slot it would go into
+size_t nip::Symbol_Table::probe(std::string_view name, uint64_t hash) const {
+	size_t mask = slots.size() - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		Symbol_t id = slots[i];
+		if (id == no_symbol) {
+			return i;
+		}
+		if (entries[id].hash == hash && (*this)[id] == name) {
+			return i;
+		}
+	}
+}
+
+void nip::Symbol_Table::rehash(size_t slot_count) {
+	slots.assign(slot_count, no_symbol);
+	size_t mask = slots.size() - 1;
+	for (Symbol_t id = 0; id < entries.size(); id++) {
+		size_t i = entries[id].hash & mask;
+		while (slots[i] != no_symbol) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = id;
+	}
+}
+
+// Makes room for count names in total without rehashing along the way
+void nip::Symbol_Table::reserve(size_t count) {
+	size_t slot_count = slots.empty() ? 1024 : slots.size();
+	while (count * 2 > slot_count) {
+		slot_count *= 2;
+	}
+	if (slot_count != slots.size()) {
+		rehash(slot_count);
+	}
+	entries.reserve(count);
+}
+
+void nip::Symbol_Table::assign(std::string_view text, const Entry_t* first, size_t count,
+                               const Symbol_t* slot_first, size_t slot_count) {
+	chars.assign(text.data(), text.size());
+	entries.assign(first, first + count);
+	slots.assign(slot_first, slot_first + slot_count);
+}
+
+nip::Symbol_t nip::Symbol_Table::intern(std::string_view name) {
+	return insert(name, nip::util::hash_bytes(name.data(), name.size()));
+}
+
+nip::Symbol_t nip::Symbol_Table::intern(const Symbol_Table& from, Symbol_t id) {
+	return insert(from[id], from.entries[id].hash);
+}
+
+nip::Symbol_t nip::Symbol_Table::insert(std::string_view name, uint64_t hash) {
+	// Keep the load factor under a half
+	if ((entries.size() + 1) * 2 > slots.size()) {
+		rehash(slots.empty() ? 1024 : slots.size() * 2);
+	}
+
+	size_t slot = probe(name, hash);
+	if (slots[slot] != no_symbol) {
+		return slots[slot];
+	}
+
+	Symbol_t id = static_cast<Symbol_t>(entries.size());
+	entries.push_back(
+	    {static_cast<uint32_t>(chars.size()), static_cast<uint32_t>(name.size()), hash});
+	chars.append(name.data(), name.size());
+	slots[slot] = id;
+	return id;
+}
+
+nip::Symbol_t nip::Symbol_Table::find(std::string_view name) const {
+	if (slots.empty()) {
+		return no_symbol;
+	}
+	return slots[probe(name, nip::util::hash_bytes(name.data(), name.size()))];
+}
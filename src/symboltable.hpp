@@ -0,0 +1,65 @@
+#pragma once
+
+#include "utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nip {
+	// Dense id of an interned name. Two names are equal exactly when their ids are.
+	using Symbol_t = uint32_t;
+
+	// Interns every distinct name once and hands out ids in order of first appearance. The text
+	// of all names lives back to back in one buffer, so the views returned by operator[] are only
+	// good until the next call to intern().
+	class Symbol_Table {
+	  public:
+		static constexpr Symbol_t no_symbol = ~Symbol_t{0};
+
+		Symbol_t intern(std::string_view name);
+		// Interns a name from another table without hashing it again
+		Symbol_t intern(const Symbol_Table& from, Symbol_t id);
+		Symbol_t find(std::string_view name) const;
+		void reserve(size_t count);
+
+		ALWAYS_INLINE std::string_view operator[](Symbol_t id) const {
+			const Entry_t& e = entries[id];
+			return std::string_view(chars.data() + e.offset, e.length);
+		}
+		size_t size() const {
+			return entries.size();
+		}
+
+		struct Entry_t {
+			uint32_t offset; // Into text()
+			uint32_t length;
+			uint64_t hash;
+		};
+
+		// The table as flat arrays, so it can be saved as is (see Lex_Cache). assign() takes them
+		// back, keeping every id, without hashing anything again.
+		std::string_view text() const {
+			return chars;
+		}
+		const std::vector<Entry_t>& entry_list() const {
+			return entries;
+		}
+		const std::vector<Symbol_t>& slot_list() const {
+			return slots;
+		}
+		void assign(std::string_view text, const Entry_t* first, size_t count,
+		            const Symbol_t* slot_first, size_t slot_count);
+
+	  private:
+		Symbol_t insert(std::string_view name, uint64_t hash);
+		void rehash(size_t slot_count);
+		size_t probe(std::string_view name, uint64_t hash) const;
+
+		std::string chars;
+		std::vector<Entry_t> entries;
+		std::vector<Symbol_t> slots; // Open addressed, power of two sized, no_symbol if empty
+	};
+}
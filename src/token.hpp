@@ -1,6 +1,12 @@
 #pragma once
 
+#include "constantpool.hpp"
+#include "decimal.hpp"
+#include "literaltable.hpp"
+#include "symboltable.hpp"
+
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <string>
 #include <vector>
@@ -33,11 +39,12 @@ namespace nip {
 		RIGHT_CARROT,  // >
 
 		// User defined stuff //
-		IDENTIFIER, // the foo in foo(->):
-		LIT_INT,    // 3
-		LIT_FLOAT,  // 3.14159
-		LIT_CHAR,   // '\t'
-		LIT_STRING, // "FOO BAR!"
+		IDENTIFIER,  // the foo in foo(->):
+		LIT_INT,     // 3
+		LIT_FLOAT,   // 3.14159
+		LIT_DECIMAL, // 1.0e400, or any number too big or too precise for the two above
+		LIT_CHAR,    // '\t'
+		LIT_STRING,  // "FOO BAR!"
 
 		// Keywords //
 		KEY_ABOUT,    // about
@@ -68,20 +75,22 @@ namespace nip {
 	};
 
 	// If more information is in an array somewhere, the address tells the compiler where to find it
-	// in the relvent table
+	// in the relvent table. Where the token is in the source is kept as a byte offset, which the
+	// source buffer turns into a line and column when something needs to show it.
 	struct Token_t {
 		Token_t() = default;
-		Token_t(TokenType_t t, size_t ln = 0, size_t cn = 0, size_t add = 0)
-		    : type(t), linenum(ln), charnum(cn), address(add){};
+		Token_t(TokenType_t t, size_t off = 0, size_t add = 0)
+		    : type(t), offset(static_cast<uint32_t>(off)), address(add){};
 		TokenType_t type = NUL; // Says the type of the token
-		size_t linenum;
-		size_t charnum;
+		uint32_t offset;
 		size_t address;
 	};
 
 	struct Token_Cache_t {
-		std::vector<int64_t> integer;
-		std::vector<double> floating_pt;
-		std::vector<std::string> identifier;
+		Constant_Pool<int64_t> integer;
+		Constant_Pool<double> floating_pt;
+		Symbol_Table identifier;
+		Literal_Table string;
+		std::vector<Decimal_t> decimal; // Rare enough not to be interned
 	};
 }
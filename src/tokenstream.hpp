@@ -0,0 +1,173 @@
+#pragma once
+
+#include "token.hpp"
+#include "util.hpp"
+#include "utilmacro.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace nip {
+	// Structure of arrays storage for the lexer's output. Token types sit in their own dense byte
+	// array so scans over them stay in cache, while payloads (the old Token_t::address) and byte
+	// offsets into the source are 32 bits each. Iterating unpacks tokens back into Token_t values.
+	class Token_Stream {
+	  public:
+		class const_iterator {
+		  public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type        = Token_t;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = const Token_t*;
+			using reference         = Token_t;
+
+			const_iterator() = default;
+
+			ALWAYS_INLINE Token_t operator*() const {
+				return (*stream)[index];
+			}
+			ALWAYS_INLINE TokenType_t type() const {
+				return stream->type(index);
+			}
+			ALWAYS_INLINE const_iterator& operator++() {
+				index++;
+				return *this;
+			}
+			ALWAYS_INLINE const_iterator operator++(int) {
+				const_iterator old = *this;
+				++*this;
+				return old;
+			}
+			ALWAYS_INLINE bool operator==(const const_iterator& rhs) const {
+				return index == rhs.index;
+			}
+			ALWAYS_INLINE bool operator!=(const const_iterator& rhs) const {
+				return index != rhs.index;
+			}
+			size_t position() const {
+				return index;
+			}
+
+		  private:
+			friend class Token_Stream;
+			const_iterator(const Token_Stream* s, size_t i) : stream(s), index(i){};
+
+			const Token_Stream* stream = nullptr;
+			size_t index               = 0;
+		};
+
+		ALWAYS_INLINE void emplace_back(TokenType_t t, size_t off = 0, size_t add = 0) {
+			types.push_back(static_cast<uint8_t>(t));
+			payloads.push_back(static_cast<uint32_t>(add));
+			offsets.push_back(static_cast<uint32_t>(off));
+		}
+
+		// For filling a stream from several threads at once: size it up front, then every writer
+		// sets its own range of tokens
+		void resize(size_t tokens) {
+			types.resize(tokens);
+			payloads.resize(tokens);
+			offsets.resize(tokens);
+		}
+		ALWAYS_INLINE void set(size_t i, TokenType_t t, size_t off, size_t add) {
+			types[i]    = static_cast<uint8_t>(t);
+			payloads[i] = static_cast<uint32_t>(add);
+			offsets[i]  = static_cast<uint32_t>(off);
+		}
+
+		// Replaces tokens [first, last) with the tokens of with, and moves the source offsets of
+		// the tokens after them by shift bytes
+		void splice(size_t first, size_t last, const Token_Stream& with, std::ptrdiff_t shift) {
+			for (size_t i = last; i < size(); i++) {
+				offsets[i] += shift;
+			}
+			auto replace = [first, last](auto& to, const auto& from) {
+				nip::util::replace_range(to, first, last - first, from.begin(), from.end());
+			};
+			replace(types, with.types);
+			replace(payloads, with.payloads);
+			replace(offsets, with.offsets);
+		}
+
+		// The three arrays as they are, for saving a stream and loading it back (see Lex_Cache)
+		const uint8_t* type_data() const {
+			return types.data();
+		}
+		const uint32_t* payload_data() const {
+			return payloads.data();
+		}
+		const uint32_t* offset_data() const {
+			return offsets.data();
+		}
+		void assign(const uint8_t* t, const uint32_t* p, const uint32_t* o, size_t count) {
+			types.assign(t, t + count);
+			payloads.assign(p, p + count);
+			offsets.assign(o, o + count);
+		}
+
+		ALWAYS_INLINE TokenType_t type(size_t i) const {
+			return static_cast<TokenType_t>(types[i]);
+		}
+		ALWAYS_INLINE uint32_t payload(size_t i) const {
+			return payloads[i];
+		}
+		ALWAYS_INLINE uint32_t offset(size_t i) const {
+			return offsets[i];
+		}
+		ALWAYS_INLINE Token_t operator[](size_t i) const {
+			return Token_t(type(i), offsets[i], payloads[i]);
+		}
+		Token_t back() const {
+			return (*this)[size() - 1];
+		}
+		ALWAYS_INLINE TokenType_t back_type() const {
+			return type(size() - 1);
+		}
+
+		size_t size() const {
+			return types.size();
+		}
+		bool empty() const {
+			return types.empty();
+		}
+		const_iterator begin() const {
+			return const_iterator(this, 0);
+		}
+		const_iterator end() const {
+			return const_iterator(this, size());
+		}
+		const_iterator at(size_t i) const {
+			return const_iterator(this, i);
+		}
+
+	  private:
+		// Leaves the elements added by resize() uninitialized, so a stream that is about to be
+		// filled in parallel isn't cleared by one thread first
+		template <class T>
+		struct Uninitialized_Allocator_t : std::allocator<T> {
+			template <class U>
+			struct rebind {
+				using other = Uninitialized_Allocator_t<U>;
+			};
+			template <class U>
+			void construct(U* p) noexcept {
+				::new (static_cast<void*>(p)) U;
+			}
+			template <class U, class... Args>
+			void construct(U* p, Args&&... args) {
+				::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+			}
+		};
+		template <class T>
+		using Array_t = std::vector<T, Uninitialized_Allocator_t<T>>;
+
+		Array_t<uint8_t> types;
+		Array_t<uint32_t> payloads;
+		Array_t<uint32_t> offsets;
+	};
+}
@@ -1,21 +1,40 @@
 #pragma once
 
 #include "utilmacro.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
+#include <iterator>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace nip {
 	namespace util {
+		// Replaces count elements of to at at with [first, last), moving the elements after them
+		// only once, and not at all when the lengths match
+		template <class Vector_t, class Iter_t>
+		void replace_range(Vector_t& to, size_t at, size_t count, Iter_t first, Iter_t last) {
+			size_t length = std::distance(first, last);
+			if (length > count) {
+				to.insert(to.begin() + at + count, length - count, *first);
+			}
+			else {
+				to.erase(to.begin() + at + length, to.begin() + at + count);
+			}
+			std::copy(first, last, to.begin() + at);
+		}
+
 		template <class Func, class... Args>
 		ALWAYS_INLINE auto bench_func(Func f, Args&&... a) {
 			auto start = std::chrono::high_resolution_clock::now();
 			auto x     = f(std::forward<Args>(a)...);
 			auto end   = std::chrono::high_resolution_clock::now();
 			return std::make_pair(
-			    x, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start));
+			    std::move(x), std::chrono::duration_cast<std::chrono::nanoseconds>(end - start));
 		}
 
 		template <class Func, class... Args>
@@ -69,13 +88,41 @@ namespace nip {
 			}
 		}
 
-		ALWAYS_INLINE std::string special_sanitize(std::string& in) {
+		ALWAYS_INLINE std::string special_sanitize(std::string_view in) {
 			std::ostringstream newstr;
 			for (auto i : in) {
 				newstr << special_sanitize(i);
 			}
 			return newstr.str();
 		}
+
+		// Fast non-cryptographic hash over a byte range. Eight bytes are folded in per multiply,
+		// and the final mix spreads every input bit over the whole result so the low bits can be
+		// used directly as a table index.
+		ALWAYS_INLINE uint64_t hash_mix(uint64_t h) {
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ull;
+			h ^= h >> 33;
+			return h;
+		}
+
+		ALWAYS_INLINE uint64_t hash_bytes(const void* data, size_t length, uint64_t seed = 0) {
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			uint64_t h             = seed ^ (length * 0x9e3779b97f4a7c15ull);
+			while (length >= 8) {
+				uint64_t word;
+				std::memcpy(&word, p, 8);
+				h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+				h = (h << 31) | (h >> 33);
+				p += 8;
+				length -= 8;
+			}
+			uint64_t tail = 0;
+			std::memcpy(&tail, p, length);
+			return hash_mix(h ^ tail);
+		}
 	}
 
 	namespace color {
@@ -10,4 +10,13 @@
 #endif
 #else
 #define ALWAYS_INLINE inline
+#endif
+
+// For the rare slow path of something ALWAYS_INLINE, so it isn't copied into every caller
+#ifdef _MSC_VER
+#define NEVER_INLINE __declspec(noinline)
+#elif defined __GNUC__
+#define NEVER_INLINE __attribute__((noinline))
+#else
+#define NEVER_INLINE
 #endif
\ No newline at end of file